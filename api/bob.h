@@ -41,10 +41,34 @@ enum bob_mood {
     BOB_CONTENTMENT = 7,
 };
 
+/**
+ * Returned by get_quality_tier. Lower tiers skip or
+ * update some analyses less often to keep up.
+ */
+enum bob_quality_tier {
+    /* Everything, every frame */
+    BOB_QUALITY_FULL,
+
+    /* Coarser chromagram, key and mood every second frame */
+    BOB_QUALITY_REDUCED,
+
+    /* Left and right channel analyses paused, key and mood every fourth frame */
+    BOB_QUALITY_LOW,
+};
+
 enum bob_channel {
     BOB_MONO_CHANNEL,
     BOB_LEFT_CHANNEL,
     BOB_RIGHT_CHANNEL,
+
+    /* (L + R) / 2, the same signal as BOB_MONO_CHANNEL */
+    BOB_MID_CHANNEL,
+
+    /* (L - R) / 2, the stereo difference. Only time and frequency data. */
+    BOB_SIDE_CHANNEL,
+
+    /* Number of channels, for arrays indexed by channel */
+    BOB_CHANNEL_COUNT,
 };
 
 /**
@@ -97,6 +121,10 @@ enum bob_audio_flags {
     /* Mood data */
     BOB_AUDIO_MOOD_MONO = (1 << 14),
     BOB_AUDIO_MOOD_STEREO = (1 << 15),
+
+    /* Side channel raw audio and frequency domain data */
+    BOB_AUDIO_TIME_DOMAIN_SIDE = (1 << 16),
+    BOB_AUDIO_FREQUENCY_DOMAIN_SIDE = (1 << 17),
 };
 
 struct bob_float_buffer {
@@ -104,6 +132,200 @@ struct bob_float_buffer {
     size_t size;
 };
 
+/**
+ * Buffers get_timed_buffer can return.
+ */
+enum bob_buffer_kind {
+    /* Same data as get_time_data */
+    BOB_BUFFER_TIME_DATA,
+
+    /* Same data as get_frequency_data */
+    BOB_BUFFER_FREQUENCY_DATA,
+
+    /* Same data as get_pulse_data, mono only */
+    BOB_BUFFER_PULSE_DATA,
+
+    /* Same data as get_pulse_graph, mono only */
+    BOB_BUFFER_PULSE_GRAPH,
+
+    /* Same data as get_tempo_graph, mono only */
+    BOB_BUFFER_TEMPO_GRAPH,
+};
+
+#define BOB_TIMED_BUFFER_VERSION 1
+
+/**
+ * Returned by get_timed_buffer. A bob_float_buffer that also tells
+ * which analysis frame the data comes from.
+ */
+struct bob_timed_buffer {
+    /* BOB_TIMED_BUFFER_VERSION of the host, fields are only ever appended */
+    int version;
+
+    const float *ptr;
+    size_t size;
+
+    /* Analysis frame the data was last updated in. The data is unchanged while this is. */
+    unsigned long long sequence;
+
+    /* When the newest sample of that frame was captured, in seconds. Only differences are meaningful. */
+    double timestamp;
+
+    /* Audio frames that analysis frame covered */
+    size_t samples;
+};
+
+enum bob_window_function {
+    BOB_WINDOW_RECTANGULAR,
+    BOB_WINDOW_TRIANGULAR,
+    BOB_WINDOW_HANN,
+    BOB_WINDOW_HAMMING,
+    BOB_WINDOW_NUTTALL,
+    BOB_WINDOW_BLACKMAN,
+    BOB_WINDOW_BLACKMAN_NUTTALL,
+    BOB_WINDOW_BLACKMAN_HARRIS,
+};
+
+/**
+ * Results kept by request_history.
+ */
+enum bob_history_kind {
+    /* Same data as get_frequency_data */
+    BOB_HISTORY_SPECTRUM,
+
+    /* Same data as get_chromagram, not for BOB_SIDE_CHANNEL */
+    BOB_HISTORY_CHROMAGRAM,
+};
+
+/**
+ * Returned by get_history. The newest results as rows of a ring, read in
+ * place. Going back i results is row (head + rows - i) % rows, for i < count.
+ * Stays valid until the visualizer is unloaded, rows change between updates.
+ */
+struct bob_history {
+    /* rows * stride floats, NULL unless requested */
+    const float *ptr;
+
+    /* Floats from the start of one row to the next */
+    size_t stride;
+
+    /* Valid floats at the start of each row */
+    size_t size;
+
+    /* Capacity of the ring */
+    size_t rows;
+
+    /* Rows written so far, at most rows */
+    size_t count;
+
+    /* Row written last */
+    size_t head;
+
+    /* Analysis frame of the newest row and its capture time, see bob_timed_buffer */
+    unsigned long long sequence;
+    double timestamp;
+};
+
+/**
+ * Band spacings for get_band_data.
+ */
+enum bob_band_scale {
+    /* Equal fractions of an octave */
+    BOB_BANDS_LOG,
+    BOB_BANDS_MEL,
+    BOB_BANDS_BARK,
+};
+
+/**
+ * Parameters for request_spectrum. The spectrum of get_frequency_data is
+ * { size_log2 = 12, padding_log2 = 2, BLACKMAN_NUTTALL, hop = 0, smoothing = 0.2 }.
+ */
+struct bob_spectrum_request {
+    /* See enum bob_channel */
+    int channel;
+
+    /* Window of 2^size_log2 samples, 6 to 14 */
+    int size_log2;
+
+    /* Zero padded to 2^(size_log2 + padding_log2) samples, 0 to 4. The spectrum has half as many bins. */
+    int padding_log2;
+
+    /* See enum bob_window_function */
+    int window;
+
+    /* Audio frames between updates, 0 updates every analysis frame */
+    int hop;
+
+    /* Weight of the newest magnitudes, above 0 and up to 1 for no smoothing */
+    float smoothing;
+};
+
+enum bob_event_type {
+    /* Onset in the low bands, value.strength is the fraction of them */
+    BOB_EVENT_BEAT,
+
+    /* Onset in any band, value.strength is the fraction of bands */
+    BOB_EVENT_ONSET,
+
+    BOB_EVENT_BREAK_START,
+    BOB_EVENT_BREAK_END,
+
+    /* value.key is the new key */
+    BOB_EVENT_KEY_CHANGE,
+
+    /* value.mood is the new enum bob_mood */
+    BOB_EVENT_MOOD_CHANGE,
+
+    /* value.tempo is the new tempo in BPM */
+    BOB_EVENT_TEMPO_CHANGE,
+};
+
+/**
+ * Returned by poll_events.
+ */
+struct bob_event {
+    enum bob_event_type type;
+
+    /* See enum bob_channel. Beats, onsets, mood and tempo are mono only. */
+    int channel;
+
+    /* Seconds of audio analyzed up to the frame the event was detected in */
+    double time;
+
+    union {
+        float strength;
+        struct bob_key key;
+        int mood;
+        float tempo;
+    } value;
+};
+
+/**
+ * Every enabled analysis result of one analyzed frame, returned by
+ * get_snapshot. Arrays are indexed by enum bob_channel. Results that
+ * were not enabled in bob_visualizer_info.enabled are zero.
+ */
+struct bob_snapshot {
+    /* Analyzed frames so far, 0 until the first frame is published */
+    unsigned long long sequence;
+
+    struct bob_float_buffer time_data[BOB_CHANNEL_COUNT];
+    struct bob_float_buffer frequency_data[BOB_CHANNEL_COUNT];
+    float chromagram[BOB_CHANNEL_COUNT][12];
+    struct bob_key key[BOB_CHANNEL_COUNT];
+
+    /* Non zero while the channel is silent, unlike in_break this is not reset when read */
+    int in_break[BOB_CHANNEL_COUNT];
+
+    /* Mono channel only */
+    struct bob_float_buffer pulse_data;
+    float tempo;
+    int mood;
+
+    /* See enum bob_quality_tier */
+    int quality_tier;
+};
+
 /**
  * BoB API.
  */
@@ -244,6 +466,70 @@ struct bob_api {
      * Set the number of partials to consider during chromagram computation.
      */
     void (*set_chromagram_num_partials)(void *context, size_t num);
+
+    /**
+     * Get the current analysis quality tier, see enum bob_quality_tier.
+     */
+    int (*get_quality_tier)(void *context);
+
+    /**
+     * Get the newest analysis results, all from the same frame. Replaces
+     * one call per result. The snapshot and its buffers stay unchanged
+     * until the next call.
+     */
+    const struct bob_snapshot *(*get_snapshot)(void *context);
+
+    /**
+     * Copy up to `max` events detected since the last call to `buf`, oldest
+     * first, and return how many were copied. Events are only detected
+     * once this was called, and for analyses that are enabled.
+     */
+    int (*poll_events)(void *context, struct bob_event *buf, int max);
+
+    /**
+     * Get a buffer (see enum bob_buffer_kind) for the specified channel
+     * together with the frame it was computed in, to skip work on
+     * unchanged data or to interpolate between frames.
+     */
+    struct bob_timed_buffer (*get_timed_buffer)(void *context, int kind, int channel);
+
+    /**
+     * Ask for a spectrum with its own parameters, only from `create`.
+     * Returns a handle for get_spectrum, or -1 for invalid parameters.
+     * Identical requests share one transform. The spectrum is computed
+     * whether or not BOB_AUDIO_FREQUENCY_DOMAIN_* is enabled.
+     */
+    int (*request_spectrum)(void *context, const struct bob_spectrum_request *request);
+
+    /**
+     * Get the magnitudes of a requested spectrum and the frame they were
+     * computed in. The sequence only changes every `hop` audio frames.
+     */
+    struct bob_timed_buffer (*get_spectrum)(void *context, int handle);
+
+    /**
+     * Get the spectrum of get_frequency_data reduced to `n_bands` (1 to 1024)
+     * overlapping triangular bands from 20 Hz to Nyquist, spaced by `scale`
+     * (see enum bob_band_scale). Each band is the weighted mean of its bins.
+     * The first call for a combination builds its filterbank, call it from
+     * `create` too to keep `update` free of allocations. Empty if the
+     * frequency data of the channel is not enabled or the arguments are invalid.
+     */
+    struct bob_timed_buffer (*get_band_data)(void *context, int channel, int n_bands, int scale);
+
+    /**
+     * Keep at least the last `rows` (1 to 4096) results of `kind` (see enum
+     * bob_history_kind) for the channel, only from `create`. The analysis has
+     * to be enabled in bob_visualizer_info.enabled. Every request for the same
+     * kind and channel shares one ring. Returns 0, or -1 on failure.
+     */
+    int (*request_history)(void *context, int kind, int channel, int rows);
+
+    /**
+     * Get the ring kept for `kind` and the channel, a new row is added each
+     * analysis frame that changes the result.
+     */
+    struct bob_history (*get_history)(void *context, int kind, int channel);
 };
 
 /********************************************
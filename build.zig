@@ -31,6 +31,14 @@ pub fn build(b: *std.Build) !void {
     const optimize = b.standardOptimizeOption(.{});
     const os_tag = target.result.os.tag;
 
+    const pipewire = b.option(bool, "pipewire", "Build the native PipeWire capture backend and use it by default (Linux)") orelse false;
+
+    const check_allocations = b.option(bool, "check-allocations", "Report allocations made by the frame loop once it runs") orelse false;
+
+    const build_options = b.addOptions();
+    build_options.addOption(bool, "pipewire", pipewire and os_tag == .linux);
+    build_options.addOption(bool, "check_allocations", check_allocations);
+
     const exe = b.addExecutable(.{
         .name = "bob",
         .root_source_file = b.path("src/main.zig"),
@@ -54,6 +62,11 @@ pub fn build(b: *std.Build) !void {
             exe.linkSystemLibrary("glfw");
             exe.linkSystemLibrary("GL");
             exe.linkSystemLibrary("pulse");
+            if (pipewire) {
+                exe.linkSystemLibrary("libpipewire-0.3");
+                exe.addIncludePath(b.path("src/audio/pipewire"));
+                exe.addCSourceFiles(.{ .files = &.{"src/audio/pipewire/shim.c"} });
+            }
         },
         .macos => {
             exe.addLibraryPath(.{ .cwd_relative = "/opt/homebrew/lib" });
@@ -66,6 +79,8 @@ pub fn build(b: *std.Build) !void {
         else => @panic("Unsupported platform"),
     }
 
+    exe.root_module.addOptions("build_options", build_options);
+
     b.installArtifact(exe);
 
     const run_cmd = b.addRunArtifact(exe);
@@ -83,6 +98,11 @@ pub fn build(b: *std.Build) !void {
         .optimize = optimize,
     });
 
+    exe_unit_tests.root_module.addOptions("build_options", build_options);
+    // Analysis code reaches bob_api.zig, which imports bob.h
+    exe_unit_tests.addIncludePath(b.path("api"));
+    exe_unit_tests.linkLibC();
+
     const run_exe_unit_tests = b.addRunArtifact(exe_unit_tests);
     const test_step = b.step("test", "Run unit tests");
     test_step.dependOn(&run_exe_unit_tests.step);
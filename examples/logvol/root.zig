@@ -15,6 +15,11 @@ var info = Info{
     .enabled = c.bob.BOB_AUDIO_FREQUENCY_DOMAIN_MONO,
 };
 
+const bars = 32;
+
+/// Bands are weighted means of their bins, scaled back to about the sums of bins drawn before
+const gain = 256.0;
+
 var vao: c.glad.GLuint = undefined;
 var vbo: c.glad.GLuint = undefined;
 var program: c.glad.GLuint = undefined;
@@ -83,6 +88,9 @@ export fn create() [*c]const u8 {
     c.glad.glDeleteShader(vshader);
     c.glad.glDeleteShader(fshader);
 
+    // Build the filterbank now rather than in the first update
+    _ = api.get_band_data.?(api.context, c.bob.BOB_MONO_CHANNEL, bars, c.bob.BOB_BANDS_MEL);
+
     return null;
 }
 
@@ -91,49 +99,17 @@ export fn update() void {
     c.glad.glUseProgram(program);
     c.glad.glBindBuffer(c.glad.GL_ARRAY_BUFFER, vbo);
 
-    const freqs: c.bob.bob_float_buffer = api.get_frequency_data.?(
-        api.context,
-        c.bob.BOB_MONO_CHANNEL,
-    );
-
-    const bins: f64 = @floatFromInt(freqs.size);
-    const bars = 32;
-
-    // TODO: move to analyzer
-    const sample_rate = 44100.0;
-    const nyquist_freq = sample_rate / 2.0;
-
-    const mel_lo = freqToMel(0);
-    const mel_hi = freqToMel(nyquist_freq);
-    const mel_step = (mel_hi - mel_lo) / bars;
-
-    var bounds: [bars + 1]usize = undefined;
-
-    bounds[0] = 0;
-    bounds[bars] = freqs.size;
-
-    inline for (1..bars) |i| {
-        const j: comptime_float = @floatFromInt(i);
-        const k: f64 = melToFreq(mel_lo + j * mel_step) / nyquist_freq * bins;
-
-        bounds[i] = @intFromFloat(@round(k));
-    }
+    const bands = api.get_band_data.?(api.context, c.bob.BOB_MONO_CHANNEL, bars, c.bob.BOB_BANDS_MEL);
 
     c.glad.glClearColor(0, 0, 0, 1);
     c.glad.glClear(c.glad.GL_COLOR_BUFFER_BIT);
 
-    inline for (bounds[0..bars], bounds[1 .. bars + 1], 0..) |a, b, i| {
-        var volume: f32 = 0;
-
-        for (freqs.ptr[a..b]) |x| {
-            volume += x;
-        }
-
-        // volume /= @floatFromInt(b - a);
+    for (bands.ptr[0..bands.size], 0..) |mean, i| {
+        const volume: f32 = mean * gain;
 
-        const step = 2.0 / @as(comptime_float, bars);
-        const left = @as(comptime_float, @floatFromInt(i)) * step - 1.0;
-        const right = @as(comptime_float, @floatFromInt(i + 1)) * step - 1.0;
+        const step = 2.0 / @as(f32, bars);
+        const left = @as(f32, @floatFromInt(i)) * step - 1.0;
+        const right = @as(f32, @floatFromInt(i + 1)) * step - 1.0;
 
         vertices[1] = volume - 0.9;
         vertices[9] = volume - 0.9;
@@ -171,16 +147,6 @@ export fn destroy() void {
     c.glad.glDeleteProgram(program);
 }
 
-// Convert from frequency (Hz) to Mel scale.
-fn freqToMel(freq: f64) f64 {
-    return 2595.0 * std.math.log10(1.0 + freq / 700.0);
-}
-
-// Convert from Mel scale to frequency (Hz).
-fn melToFreq(mel: f64) f64 {
-    return 700.0 * (std.math.pow(f64, 10.0, mel / 2595.0) - 1.0);
-}
-
 fn volumeBars() void {}
 
 // Verify that type signatures are correct
@@ -63,6 +63,9 @@ export fn get_info() [*c]const Info {
 var over_time: [256][128]f32 = undefined;
 var over_time_index: usize = 0;
 
+/// Sequence of the spectrum the last row was made from
+var last_sequence: u64 = 0;
+
 var vertices: std.ArrayList(f32) = undefined;
 var gpa: std.heap.GeneralPurposeAllocator(.{}) = .{};
 
@@ -122,8 +125,8 @@ fn freqToMel(freq: f64) f64 {
 }
 
 export fn update() void {
-    _ = multiplier.update();
-    _ = adjust.update();
+    const multiplier_changed = multiplier.update();
+    const adjust_changed = adjust.update();
     glad.glBindVertexArray(vao);
     //glad.glUseProgram(program);
     glad.glBindBuffer(glad.GL_ARRAY_BUFFER, vbo);
@@ -134,102 +137,111 @@ export fn update() void {
         glad.glViewport(0, 0, w, h);
     }
 
-    // This is mostly copy pasterino from logval.
-    const freqs = api.get_frequency_data.?(api.context, bob.BOB_MONO_CHANNEL);
-    const bins: f64 = @floatFromInt(freqs.size);
-    const bars = over_time[0].len;
+    // Only new analysis frames add a row, and only then the vertices change
+    const freqs = api.get_timed_buffer.?(api.context, bob.BOB_BUFFER_FREQUENCY_DATA, bob.BOB_MONO_CHANNEL);
+    const fresh = freqs.sequence != last_sequence;
+    last_sequence = freqs.sequence;
 
-    // TODO: move to analyzer
-    const sample_rate = 44100.0;
-    const nyquist_freq = sample_rate / 2.0;
+    if (fresh) {
+        // This is mostly copy pasterino from logval.
+        const bins: f64 = @floatFromInt(freqs.size);
+        const bars = over_time[0].len;
 
-    const mel_lo = freqToMel(0);
-    const mel_hi = freqToMel(nyquist_freq);
-    const mel_step = (mel_hi - mel_lo) / bars;
+        // TODO: move to analyzer
+        const sample_rate = 44100.0;
+        const nyquist_freq = sample_rate / 2.0;
 
-    var bounds: [bars + 1]usize = undefined;
+        const mel_lo = freqToMel(0);
+        const mel_hi = freqToMel(nyquist_freq);
+        const mel_step = (mel_hi - mel_lo) / bars;
 
-    bounds[0] = 0;
-    bounds[bars] = freqs.size;
+        var bounds: [bars + 1]usize = undefined;
 
-    inline for (1..bars) |i| {
-        const j: comptime_float = @floatFromInt(i);
-        const k: f64 = melToFreq(mel_lo + j * mel_step) / nyquist_freq * bins;
+        bounds[0] = 0;
+        bounds[bars] = freqs.size;
 
-        bounds[i] = @intFromFloat(@round(k));
-    }
+        inline for (1..bars) |i| {
+            const j: comptime_float = @floatFromInt(i);
+            const k: f64 = melToFreq(mel_lo + j * mel_step) / nyquist_freq * bins;
+
+            bounds[i] = @intFromFloat(@round(k));
+        }
+
+        inline for (bounds[0..bars], bounds[1 .. bars + 1], 0..) |a, b, i| {
+            var volume: f32 = 0;
 
-    inline for (bounds[0..bars], bounds[1 .. bars + 1], 0..) |a, b, i| {
-        var volume: f32 = 0;
+            for (freqs.ptr[a..b]) |x| {
+                volume += x;
+            }
 
-        for (freqs.ptr[a..b]) |x| {
-            volume += x;
+            over_time[over_time_index][i] = volume;
         }
 
-        over_time[over_time_index][i] = volume;
+        over_time_index = (over_time_index + 1) % over_time.len;
     }
 
-    over_time_index = (over_time_index + 1) % over_time.len;
-
     glad.glClearColor(0, 0, 0, 1);
     glad.glClear(glad.GL_COLOR_BUFFER_BIT);
-    vertices.clearRetainingCapacity();
-
-    const square_width = 1.3 / @as(f32, @floatFromInt(over_time[0].len));
-    const square_height = 2.0 / @as(f32, @floatFromInt(over_time.len));
-    const y_shift_by: f32 = -1;
-    const x_shift_by: f32 = adjust.value;
     shader_program.bind();
-    for (0..over_time.len) |i| {
-        const i_f: f32 = @floatFromInt(i);
-        const index: usize = @intCast((over_time.len * 2 + over_time_index - 1 - i) % over_time.len);
-        for (0..over_time[0].len) |j| {
-            const j_f: f32 = @floatFromInt(j);
-
-            const grayscale = @log10(over_time[index][j] * multiplier.value);
-            const red = grayscale;
-            const blue = if (grayscale < 0.5) grayscale else grayscale - 0.5;
-            const green = 1.0 - 4.0 * std.math.pow(f32, grayscale - 0.5, 2.0);
-
-            vertices.append(x_shift_by + j_f * square_width) catch unreachable;
-            vertices.append(y_shift_by + i_f * square_height) catch unreachable;
-            vertices.append(red) catch unreachable;
-            vertices.append(blue) catch unreachable;
-            vertices.append(green) catch unreachable;
-            vertices.append(x_shift_by + j_f * square_width) catch unreachable;
-            vertices.append(y_shift_by + i_f * square_height - square_height) catch unreachable;
-            vertices.append(red) catch unreachable;
-            vertices.append(blue) catch unreachable;
-            vertices.append(green) catch unreachable;
-            vertices.append(x_shift_by + j_f * square_width - square_width) catch unreachable;
-            vertices.append(y_shift_by + i_f * square_height - square_height) catch unreachable;
-            vertices.append(red) catch unreachable;
-            vertices.append(blue) catch unreachable;
-            vertices.append(green) catch unreachable;
-            vertices.append(x_shift_by + j_f * square_width - square_width) catch unreachable;
-            vertices.append(y_shift_by + i_f * square_height - square_height) catch unreachable;
-            vertices.append(red) catch unreachable;
-            vertices.append(blue) catch unreachable;
-            vertices.append(green) catch unreachable;
-            vertices.append(x_shift_by + j_f * square_width - square_width) catch unreachable;
-            vertices.append(y_shift_by + i_f * square_height) catch unreachable;
-            vertices.append(red) catch unreachable;
-            vertices.append(blue) catch unreachable;
-            vertices.append(green) catch unreachable;
-            vertices.append(x_shift_by + j_f * square_width) catch unreachable;
-            vertices.append(y_shift_by + i_f * square_height) catch unreachable;
-            vertices.append(red) catch unreachable;
-            vertices.append(blue) catch unreachable;
-            vertices.append(green) catch unreachable;
+
+    if (fresh or multiplier_changed or adjust_changed) {
+        vertices.clearRetainingCapacity();
+
+        const square_width = 1.3 / @as(f32, @floatFromInt(over_time[0].len));
+        const square_height = 2.0 / @as(f32, @floatFromInt(over_time.len));
+        const y_shift_by: f32 = -1;
+        const x_shift_by: f32 = adjust.value;
+        for (0..over_time.len) |i| {
+            const i_f: f32 = @floatFromInt(i);
+            const index: usize = @intCast((over_time.len * 2 + over_time_index - 1 - i) % over_time.len);
+            for (0..over_time[0].len) |j| {
+                const j_f: f32 = @floatFromInt(j);
+
+                const grayscale = @log10(over_time[index][j] * multiplier.value);
+                const red = grayscale;
+                const blue = if (grayscale < 0.5) grayscale else grayscale - 0.5;
+                const green = 1.0 - 4.0 * std.math.pow(f32, grayscale - 0.5, 2.0);
+
+                vertices.append(x_shift_by + j_f * square_width) catch unreachable;
+                vertices.append(y_shift_by + i_f * square_height) catch unreachable;
+                vertices.append(red) catch unreachable;
+                vertices.append(blue) catch unreachable;
+                vertices.append(green) catch unreachable;
+                vertices.append(x_shift_by + j_f * square_width) catch unreachable;
+                vertices.append(y_shift_by + i_f * square_height - square_height) catch unreachable;
+                vertices.append(red) catch unreachable;
+                vertices.append(blue) catch unreachable;
+                vertices.append(green) catch unreachable;
+                vertices.append(x_shift_by + j_f * square_width - square_width) catch unreachable;
+                vertices.append(y_shift_by + i_f * square_height - square_height) catch unreachable;
+                vertices.append(red) catch unreachable;
+                vertices.append(blue) catch unreachable;
+                vertices.append(green) catch unreachable;
+                vertices.append(x_shift_by + j_f * square_width - square_width) catch unreachable;
+                vertices.append(y_shift_by + i_f * square_height - square_height) catch unreachable;
+                vertices.append(red) catch unreachable;
+                vertices.append(blue) catch unreachable;
+                vertices.append(green) catch unreachable;
+                vertices.append(x_shift_by + j_f * square_width - square_width) catch unreachable;
+                vertices.append(y_shift_by + i_f * square_height) catch unreachable;
+                vertices.append(red) catch unreachable;
+                vertices.append(blue) catch unreachable;
+                vertices.append(green) catch unreachable;
+                vertices.append(x_shift_by + j_f * square_width) catch unreachable;
+                vertices.append(y_shift_by + i_f * square_height) catch unreachable;
+                vertices.append(red) catch unreachable;
+                vertices.append(blue) catch unreachable;
+                vertices.append(green) catch unreachable;
+            }
         }
-    }
 
-    glad.glBufferData(
-        glad.GL_ARRAY_BUFFER,
-        @intCast(vertices.items.len * @sizeOf(f32)),
-        @ptrCast(vertices.items),
-        glad.GL_STREAM_DRAW,
-    );
+        glad.glBufferData(
+            glad.GL_ARRAY_BUFFER,
+            @intCast(vertices.items.len * @sizeOf(f32)),
+            @ptrCast(vertices.items),
+            glad.GL_STREAM_DRAW,
+        );
+    }
 
     glad.glDrawArrays(
         glad.GL_TRIANGLES,
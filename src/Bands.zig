@@ -0,0 +1,92 @@
+//!
+//! The built-in spectra reduced to bands for `get_band_data`. Each channel,
+//! band count and scale gets its own filterbank, built on first use and reused
+//! until the next `reset`. Bands are recomputed only when the spectrum changed.
+//!
+
+const std = @import("std");
+const Bands = @This();
+
+const AudioAnalyzer = @import("audio/AudioAnalyzer.zig");
+const AudioSplixer = @import("audio/AudioSplixer.zig");
+const Filterbank = @import("audio/Filterbank.zig");
+
+const Entry = struct {
+    channel: AudioSplixer.Channel,
+    scale: Filterbank.Scale,
+    filterbank: Filterbank,
+    values: []f32,
+
+    /// Spectrum sequence `values` was computed from, null before the first time
+    sequence: ?u64,
+};
+
+entries: std.ArrayListUnmanaged(Entry),
+
+pub fn init() Bands {
+    return .{ .entries = .{} };
+}
+
+pub fn deinit(self: *Bands, allocator: std.mem.Allocator) void {
+    self.reset(allocator);
+    self.entries.deinit(allocator);
+    self.* = undefined;
+}
+
+/// Free all filterbanks, for a newly loaded visualizer
+pub fn reset(self: *Bands, allocator: std.mem.Allocator) void {
+    for (self.entries.items) |*entry| {
+        entry.filterbank.deinit(allocator);
+        allocator.free(entry.values);
+    }
+    self.entries.clearRetainingCapacity();
+}
+
+/// Bands of the spectrum of `channel` and the frame that spectrum comes from,
+/// null if the spectrum is not enabled. Only allocates the first time for a combination.
+pub fn read(
+    self: *Bands,
+    analyzer: *AudioAnalyzer,
+    channel: AudioSplixer.Channel,
+    bands: usize,
+    scale: Filterbank.Scale,
+    allocator: std.mem.Allocator,
+) !?struct { data: []const f32, stamp: AudioAnalyzer.Stamp } {
+    const job = AudioAnalyzer.spectrumJob(channel);
+    const fft = analyzer.builtinSpectrum(channel) orelse return null;
+
+    analyzer.require(job);
+    const stamp = analyzer.stamps.get(job);
+
+    const entry = try self.find(channel, bands, scale, fft.outputLength(), allocator);
+    if (entry.sequence == null or entry.sequence.? != stamp.sequence) {
+        entry.filterbank.apply(fft.read(), entry.values);
+        entry.sequence = stamp.sequence;
+    }
+
+    return .{ .data = entry.values, .stamp = stamp };
+}
+
+fn find(self: *Bands, channel: AudioSplixer.Channel, bands: usize, scale: Filterbank.Scale, bins: usize, allocator: std.mem.Allocator) !*Entry {
+    for (self.entries.items) |*entry| {
+        if (entry.channel == channel and entry.scale == scale and entry.values.len == bands) {
+            return entry;
+        }
+    }
+
+    try self.entries.ensureUnusedCapacity(allocator, 1);
+
+    var filterbank = try Filterbank.init(scale, bands, bins, allocator);
+    errdefer filterbank.deinit(allocator);
+
+    const values = try allocator.alloc(f32, bands);
+
+    self.entries.appendAssumeCapacity(.{
+        .channel = channel,
+        .scale = scale,
+        .filterbank = filterbank,
+        .values = values,
+        .sequence = null,
+    });
+    return &self.entries.items[self.entries.items.len - 1];
+}
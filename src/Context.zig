@@ -9,12 +9,21 @@ const AudioAnalyzer = @import("audio/AudioAnalyzer.zig");
 const AudioConfig = @import("audio/Config.zig");
 const AudioCapturer = @import("audio/AudioCapturer.zig");
 const AudioSplixer = @import("audio/AudioSplixer.zig");
+const Mixer = @import("audio/Mixer.zig");
+const Governor = @import("audio/Governor.zig");
+const Snapshot = @import("Snapshot.zig");
+const Events = @import("Events.zig");
+const Bands = @import("Bands.zig");
+const History = @import("History.zig");
 const Config = @import("audio/Config.zig");
 const Visualizer = @import("Visualizer.zig");
 const GuiState = @import("GuiState.zig");
 const Error = @import("Error.zig");
 const FFT = @import("audio/fft.zig").FastFourierTransform;
 const Flags = @import("flags.zig").Flags;
+const Task = @import("task.zig").Task;
+const trace = @import("trace.zig");
+const CountingAllocator = @import("CountingAllocator.zig");
 
 /// The current error message
 err: Error,
@@ -25,15 +34,42 @@ gui_state: GuiState,
 /// The currently selected visualizer, or null if none is selected
 visualizer: ?Visualizer,
 
-/// The audio capture backend, if a source process is selected, otherwise null
-capturer: ?AudioCapturer,
+/// Connected capture sources, mixed into the analyzed stream
+mixer: Mixer,
+
+/// Connection attempt running in the background, adopted by `pollConnect`
+connecting: Task(*AudioCapturer),
+
+/// Copy of the process id being connected to, owned by the connection attempt
+connect_process_id: std.BoundedArray(u8, 64),
+
+/// Request low latency capture on the next connect
+low_latency: bool,
 
 /// Audio analyzer
 analyzer: AudioAnalyzer,
 
+/// Allocator of `init`, for API calls that allocate
+allocator: std.mem.Allocator,
+
 /// Enabled analysises for the current visualizer
 flags: Flags,
 
+/// Lowers analysis quality when it takes too long
+governor: Governor,
+
+/// Results of the last frame for `get_snapshot`
+snapshot: Snapshot,
+
+/// Detected events for `poll_events`
+events: Events,
+
+/// Filterbanks and results for `get_band_data`
+bands: Bands,
+
+/// Past spectra and chromagrams for `get_history`
+history: History,
+
 // Windows size and state
 window_width: i32,
 window_height: i32,
@@ -44,38 +80,124 @@ pub fn init(allocator: std.mem.Allocator) !Context {
         .err = Error{},
         .gui_state = GuiState.init(allocator),
         .visualizer = null,
-        .capturer = null,
+        .mixer = try Mixer.init(allocator),
+        .connecting = .{},
+        .connect_process_id = .{},
+        .low_latency = false,
         .analyzer = try AudioAnalyzer.init(allocator),
+        .allocator = allocator,
         .flags = Flags{},
+        .governor = .{},
+        .snapshot = Snapshot.init(),
+        .events = Events.init(),
+        .bands = Bands.init(),
+        .history = History.init(),
         .window_width = 0,
         .window_height = 0,
         .window_did_resize = false,
     };
 }
 
-/// Connect to a process by PID
+/// Start connecting to a process by PID, or to a test signal if prefixed by `gen:`,
+/// adding it to the connected sources. Connection happens in the background, see `pollConnect`.
 pub fn connect(self: *Context, process_id: []const u8, allocator: std.mem.Allocator) !void {
-    if (self.capturer) |_| {
-        unreachable;
+    if (self.connecting.isRunning()) {
+        return error.already_connecting;
     }
 
-    const config: AudioConfig = .{ .process_id = process_id };
-    self.capturer = try AudioCapturer.init(config, allocator);
-    try self.capturer.?.start();
+    const len = @min(process_id.len, self.connect_process_id.capacity());
+    self.connect_process_id = std.BoundedArray(u8, 64).fromSlice(process_id[0..len]) catch unreachable;
+
+    const config = AudioConfig.fromProcessId(self.connect_process_id.slice(), self.low_latency);
+    try self.connecting.start(connectTask, .{ config, allocator });
 }
 
-/// Disconnect from connected process
-pub fn disconnect(self: *Context, allocator: std.mem.Allocator) !void {
-    try self.capturer.?.stop();
-    self.capturer.?.deinit(allocator);
-    self.capturer = null;
+/// Add the capturer of a finished connection attempt, or return its error
+pub fn pollConnect(self: *Context, allocator: std.mem.Allocator) !void {
+    if (self.connecting.poll()) |result| {
+        const capturer = try result;
+        errdefer destroyCapturer(capturer, allocator);
+
+        try self.mixer.add(capturer, self.connect_process_id.slice(), allocator);
+    }
 }
 
-/// Run enabled analysis
+fn connectTask(config: AudioConfig, allocator: std.mem.Allocator) !*AudioCapturer {
+    const capturer = try allocator.create(AudioCapturer);
+    errdefer allocator.destroy(capturer);
+
+    capturer.* = try AudioCapturer.init(config, allocator);
+    errdefer capturer.deinit(allocator);
+
+    try capturer.start();
+
+    return capturer;
+}
+
+fn destroyCapturer(capturer: *AudioCapturer, allocator: std.mem.Allocator) void {
+    capturer.stop() catch {
+        std.debug.print("Failed to stop capturer.", .{});
+    };
+    capturer.deinit(allocator);
+    allocator.destroy(capturer);
+}
+
+/// Disconnect from the source at `index` in `mixer.sources`
+pub fn disconnect(self: *Context, index: usize, allocator: std.mem.Allocator) !void {
+    try self.mixer.sources.items[index].capturer.stop();
+
+    const capturer = self.mixer.remove(index, allocator);
+    capturer.deinit(allocator);
+    allocator.destroy(capturer);
+}
+
+/// Enable the analyses a visualizer asks for, allocating only what they need
+pub fn setFlags(self: *Context, flags: Flags, allocator: std.mem.Allocator) !void {
+    try self.analyzer.configure(flags, allocator);
+    try self.snapshot.configure(&self.analyzer, allocator);
+    self.events.reset();
+    self.bands.reset(allocator);
+    self.history.reset(allocator);
+    self.flags = flags;
+}
+
+/// True if at least one source is connected
+pub fn isConnected(self: *const Context) bool {
+    return self.mixer.sources.items.len > 0;
+}
+
+/// Run enabled analysis on the mix of all sources
 pub fn processAudio(self: *Context) void {
-    if (self.capturer) |*capturer| {
-        const sample = capturer.sample();
-        self.analyzer.analyze(sample, self.flags);
+    if (self.isConnected()) {
+        CountingAllocator.enter();
+        defer CountingAllocator.leave();
+
+        const sample = blk: {
+            const mix_zone = trace.zone("mix");
+            defer mix_zone.end();
+            break :blk self.mixer.mix();
+        };
+
+        const analyze_zone = trace.zone("analyze");
+        defer analyze_zone.end();
+
+        // The newest mixed sample left the source one capture latency ago
+        const now = @as(f64, @floatFromInt(std.time.nanoTimestamp())) / std.time.ns_per_s;
+        self.analyzer.capture_time = now - @as(f64, @floatFromInt(self.mixer.latency())) / std.time.us_per_s;
+
+        const start = std.time.nanoTimestamp();
+        self.analyzer.analyze(sample);
+        const elapsed: u64 = @intCast(@max(std.time.nanoTimestamp() - start, 0));
+
+        // Lazy jobs evaluated on demand since the last frame are part of the cost
+        self.analyzer.quality = self.governor.update(elapsed + self.analyzer.takeRequireTime());
+
+        self.events.detect(&self.analyzer, sample.len / Config.channel_count);
+        self.history.update(&self.analyzer);
+
+        if (self.snapshot.wanted.load(.acquire)) {
+            self.snapshot.publish(&self.analyzer);
+        }
     }
 }
 
@@ -86,13 +208,21 @@ pub fn deinit(self: *Context, allocator: std.mem.Allocator) void {
         visualizer.unload();
     }
 
-    if (self.capturer) |*capturer| {
-        capturer.stop() catch {
-            std.debug.print("Failed to stop capturer.", .{});
-        };
-        capturer.deinit(allocator);
+    // A pending connection attempt has to finish before it can be torn down
+    if (self.connecting.wait()) |result| {
+        if (result) |capturer| {
+            destroyCapturer(capturer, allocator);
+        } else |_| {}
+    }
+
+    for (self.mixer.sources.items) |source| {
+        destroyCapturer(source.capturer, allocator);
     }
+    self.mixer.deinit(allocator);
 
     self.err.clear(allocator);
+    self.snapshot.deinit(allocator);
+    self.bands.deinit(allocator);
+    self.history.deinit(allocator);
     self.analyzer.deinit(allocator);
 }
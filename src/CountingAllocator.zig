@@ -0,0 +1,84 @@
+//!
+//! Allocator wrapper that counts allocations per thread and reports any made
+//! while the calling thread is in a steady-state section, where the frame loop
+//! is expected to run without allocating. Enabled with `-Dcheck-allocations`.
+//!
+
+const std = @import("std");
+const CountingAllocator = @This();
+
+const log = std.log.scoped(.allocations);
+
+backing: std.mem.Allocator,
+
+/// Allocations and growing resizes on all threads
+total: std.atomic.Value(usize) = std.atomic.Value(usize).init(0),
+
+/// Allocations made inside steady-state sections on all threads
+violations: std.atomic.Value(usize) = std.atomic.Value(usize).init(0),
+
+/// Allocations and growing resizes on the calling thread
+threadlocal var thread_count: usize = 0;
+
+/// Nesting depth of steady-state sections on the calling thread
+threadlocal var steady_depth: u32 = 0;
+
+pub fn init(backing: std.mem.Allocator) CountingAllocator {
+    return CountingAllocator{ .backing = backing };
+}
+
+pub fn allocator(self: *CountingAllocator) std.mem.Allocator {
+    return .{
+        .ptr = self,
+        .vtable = &.{
+            .alloc = alloc,
+            .resize = resize,
+            .free = free,
+        },
+    };
+}
+
+/// Allocations made by the calling thread through any counting allocator
+pub fn threadCount() usize {
+    return thread_count;
+}
+
+/// Mark the calling thread as being in steady state until `leave`
+pub fn enter() void {
+    steady_depth += 1;
+}
+
+pub fn leave() void {
+    std.debug.assert(steady_depth > 0);
+    steady_depth -= 1;
+}
+
+fn count(self: *CountingAllocator, len: usize, ret_addr: usize) void {
+    thread_count += 1;
+    _ = self.total.fetchAdd(1, .monotonic);
+
+    if (steady_depth > 0) {
+        _ = self.violations.fetchAdd(1, .monotonic);
+        log.err("{d} bytes allocated in steady state, {d} allocations on this thread", .{ len, thread_count });
+        std.debug.dumpCurrentStackTrace(ret_addr);
+    }
+}
+
+fn alloc(ctx: *anyopaque, len: usize, ptr_align: u8, ret_addr: usize) ?[*]u8 {
+    const self: *CountingAllocator = @ptrCast(@alignCast(ctx));
+    self.count(len, ret_addr);
+    return self.backing.rawAlloc(len, ptr_align, ret_addr);
+}
+
+fn resize(ctx: *anyopaque, buf: []u8, buf_align: u8, new_len: usize, ret_addr: usize) bool {
+    const self: *CountingAllocator = @ptrCast(@alignCast(ctx));
+    if (new_len > buf.len) {
+        self.count(new_len - buf.len, ret_addr);
+    }
+    return self.backing.rawResize(buf, buf_align, new_len, ret_addr);
+}
+
+fn free(ctx: *anyopaque, buf: []u8, buf_align: u8, ret_addr: usize) void {
+    const self: *CountingAllocator = @ptrCast(@alignCast(ctx));
+    self.backing.rawFree(buf, buf_align, ret_addr);
+}
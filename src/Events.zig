@@ -0,0 +1,194 @@
+//!
+//! Beats, onsets, breaks and changes of key, mood and tempo, detected after
+//! each analyzed frame and queued until a visualizer drains them. The queue
+//! is lock-free with one producer and one consumer.
+//!
+
+const std = @import("std");
+const Events = @This();
+
+const bob = @import("bob_api.zig");
+const AudioAnalyzer = @import("audio/AudioAnalyzer.zig");
+const Beat = @import("audio/Beat.zig");
+const Config = @import("audio/Config.zig");
+const Job = AudioAnalyzer.Job;
+
+const log = std.log.scoped(.events);
+
+/// Events held until polled, newer events are dropped when full
+pub const capacity = 256;
+
+/// Low bands that count for beats, as a fraction of all bands
+const beat_bands = 0.25;
+
+/// Bands that have to rise together for an onset
+const min_onset_bands = 3;
+
+/// Smallest tempo difference in BPM reported as a change
+const min_tempo_change = 1.0;
+
+queue: [capacity]bob.bob_event,
+
+/// Total events polled, only written by the consumer
+head: std.atomic.Value(usize),
+
+/// Total events pushed, only written by the producer
+tail: std.atomic.Value(usize),
+
+/// Events lost to a full queue since it last had room
+dropped: usize,
+
+/// A visualizer has polled since the last `reset`
+wanted: std.atomic.Value(bool),
+
+/// Frames analyzed, the time base of events
+frames: u64,
+
+onsets: std.meta.FieldType(Beat, .Eh),
+breaks: [3]bool,
+keys: [3]?bob.bob_key,
+mood: ?c_int,
+tempo: f32,
+
+pub fn init() Events {
+    var self: Events = undefined;
+    self.head = std.atomic.Value(usize).init(0);
+    self.tail = std.atomic.Value(usize).init(0);
+    self.frames = 0;
+    self.reset();
+    return self;
+}
+
+/// Forget detection state, for a newly loaded visualizer. Consumer thread only.
+pub fn reset(self: *Events) void {
+    self.head.store(self.tail.load(.acquire), .release);
+    self.wanted.store(false, .release);
+    self.dropped = 0;
+    @memset(&self.onsets, 0);
+    self.breaks = .{ false, false, false };
+    self.keys = .{ null, null, null };
+    self.mood = null;
+    self.tempo = 0.0;
+}
+
+/// Copy queued events to `out`, returning how many. Consumer thread only.
+pub fn poll(self: *Events, out: []bob.bob_event) usize {
+    self.wanted.store(true, .release);
+
+    const head = self.head.load(.monotonic);
+    const tail = self.tail.load(.acquire);
+    const len = @min(tail -% head, out.len);
+
+    for (out[0..len], 0..) |*event, i| {
+        event.* = self.queue[(head +% i) % capacity];
+    }
+    self.head.store(head +% len, .release);
+
+    return len;
+}
+
+/// Compare the frame `analyzer` just analyzed from `frames` frames with the last one. Producer thread only.
+pub fn detect(self: *Events, analyzer: *AudioAnalyzer, frames: usize) void {
+    const time = @as(f64, @floatFromInt(self.frames)) / Config.sample_rate;
+    self.frames += frames;
+
+    if (!self.wanted.load(.acquire)) {
+        return;
+    }
+
+    if (analyzer.beat_center) |*beat| {
+        const low = @max(1, @as(usize, @intFromFloat(@as(f32, @floatFromInt(beat.num_bins)) * beat_bands)));
+        var rising: usize = 0;
+        var rising_low: usize = 0;
+
+        for (0..beat.num_bins) |i| {
+            if (beat.Eh[i] > self.onsets[i]) {
+                rising += 1;
+                if (i < low) rising_low += 1;
+            }
+        }
+        self.onsets = beat.Eh;
+
+        if (rising >= min_onset_bands) {
+            self.push(bob.BOB_EVENT_ONSET, bob.BOB_MONO_CHANNEL, time, .{ .strength = fraction(rising, beat.num_bins) });
+        }
+        if (rising_low * 2 >= low) {
+            self.push(bob.BOB_EVENT_BEAT, bob.BOB_MONO_CHANNEL, time, .{ .strength = fraction(rising_low, low) });
+        }
+    }
+
+    inline for (.{
+        .{ bob.BOB_MONO_CHANNEL, Job.key_center, "key_center", Job.breaks_center, "breaks_center" },
+        .{ bob.BOB_LEFT_CHANNEL, Job.key_left, "key_left", Job.breaks_left, "breaks_left" },
+        .{ bob.BOB_RIGHT_CHANNEL, Job.key_right, "key_right", Job.breaks_right, "breaks_right" },
+    }) |entry| {
+        const i = entry[0];
+
+        if (analyzer.live.contains(entry[3])) {
+            const in_break = @field(analyzer, entry[4]).in_break;
+            if (in_break != self.breaks[i]) {
+                self.push(if (in_break) bob.BOB_EVENT_BREAK_START else bob.BOB_EVENT_BREAK_END, entry[0], time, .{ .strength = 0.0 });
+            }
+            self.breaks[i] = in_break;
+        }
+
+        if (analyzer.live.contains(entry[1])) {
+            analyzer.require(entry[1]);
+            const result = @field(analyzer, entry[2]).result;
+            const key = bob.bob_key{
+                .pitch_class = @intCast(result.pitch_class),
+                .type = @intCast(result.key_type),
+                .confidence = result.confidence,
+            };
+
+            const previous = self.keys[i];
+            if (previous == null or previous.?.pitch_class != key.pitch_class or previous.?.type != key.type) {
+                self.push(bob.BOB_EVENT_KEY_CHANGE, entry[0], time, .{ .key = key });
+            }
+            self.keys[i] = key;
+        }
+    }
+
+    if (analyzer.mood_center != null) {
+        analyzer.require(.mood_center);
+        const mood = @intFromEnum(analyzer.mood_center.?.read());
+        if (self.mood == null or self.mood.? != mood) {
+            self.push(bob.BOB_EVENT_MOOD_CHANGE, bob.BOB_MONO_CHANNEL, time, .{ .mood = mood });
+        }
+        self.mood = mood;
+    }
+
+    if (analyzer.tempo_center) |*tempo| {
+        const bpm = tempo.get_bpm();
+        if (@abs(bpm - self.tempo) >= min_tempo_change) {
+            self.push(bob.BOB_EVENT_TEMPO_CHANGE, bob.BOB_MONO_CHANNEL, time, .{ .tempo = bpm });
+            self.tempo = bpm;
+        }
+    }
+}
+
+fn push(self: *Events, kind: c_int, channel: c_int, time: f64, value: std.meta.FieldType(bob.bob_event, .value)) void {
+    const tail = self.tail.load(.monotonic);
+    const head = self.head.load(.acquire);
+
+    if (tail -% head == capacity) {
+        if (self.dropped == 0) {
+            log.warn("queue full, dropping events until the visualizer polls", .{});
+        }
+        self.dropped += 1;
+        return;
+    }
+    self.dropped = 0;
+
+    self.queue[tail % capacity] = .{
+        .type = @intCast(kind),
+        .channel = channel,
+        .time = time,
+        .value = value,
+    };
+    self.tail.store(tail +% 1, .release);
+}
+
+fn fraction(count: usize, total: usize) f32 {
+    return @as(f32, @floatFromInt(count)) / @as(f32, @floatFromInt(total));
+}
@@ -0,0 +1,165 @@
+//!
+//! Rings of the newest spectra and chromagrams per channel for `get_history`,
+//! read by visualizers in place. A ring is allocated when first requested and
+//! shared by every request for its kind and channel until the next `reset`.
+//!
+
+const std = @import("std");
+const History = @This();
+
+const AudioAnalyzer = @import("audio/AudioAnalyzer.zig");
+const AudioSplixer = @import("audio/AudioSplixer.zig");
+const Job = AudioAnalyzer.Job;
+
+const log = std.log.scoped(.history);
+
+pub const Kind = enum { spectrum, chromagram };
+
+/// Rows start on cache lines
+const row_align = std.atomic.cache_line;
+
+pub const max_rows = 4096;
+
+pub const Ring = struct {
+    kind: Kind,
+    channel: AudioSplixer.Channel,
+
+    /// `rows` rows of `stride` floats
+    data: []align(row_align) f32,
+    stride: usize,
+
+    /// Valid floats per row
+    size: usize,
+    rows: usize,
+
+    /// Rows written, at most `rows`
+    count: usize,
+
+    /// Row written last
+    head: usize,
+
+    /// Frame of the newest row
+    stamp: AudioAnalyzer.Stamp,
+};
+
+rings: std.ArrayListUnmanaged(Ring),
+
+pub fn init() History {
+    return .{ .rings = .{} };
+}
+
+pub fn deinit(self: *History, allocator: std.mem.Allocator) void {
+    self.reset(allocator);
+    self.rings.deinit(allocator);
+    self.* = undefined;
+}
+
+/// Free all rings, for a newly loaded visualizer
+pub fn reset(self: *History, allocator: std.mem.Allocator) void {
+    for (self.rings.items) |ring| {
+        allocator.free(ring.data);
+    }
+    self.rings.clearRetainingCapacity();
+}
+
+pub const Error = error{ invalid_history_request, analysis_disabled };
+
+/// Keep at least the last `rows` results of `kind` for `channel`. A ring
+/// that is already big enough is shared, a smaller one is replaced.
+pub fn request(self: *History, analyzer: *AudioAnalyzer, kind: Kind, channel: AudioSplixer.Channel, rows: usize, allocator: std.mem.Allocator) !void {
+    if (rows == 0 or rows > max_rows) {
+        return Error.invalid_history_request;
+    }
+    const size = (source(analyzer, kind, channel) orelse return Error.analysis_disabled).len;
+
+    const index = for (self.rings.items, 0..) |ring, i| {
+        if (ring.kind == kind and ring.channel == channel) break i;
+    } else null;
+
+    if (index) |i| {
+        if (self.rings.items[i].rows >= rows) {
+            return;
+        }
+    } else {
+        try self.rings.ensureUnusedCapacity(allocator, 1);
+    }
+
+    const stride = std.mem.alignForward(usize, size, row_align / @sizeOf(f32));
+    const data = try allocator.alignedAlloc(f32, row_align, stride * rows);
+    @memset(data, 0.0);
+
+    const ring = Ring{
+        .kind = kind,
+        .channel = channel,
+        .data = data,
+        .stride = stride,
+        .size = size,
+        .rows = rows,
+        .count = 0,
+        .head = rows - 1,
+        .stamp = .{},
+    };
+
+    if (index) |i| {
+        allocator.free(self.rings.items[i].data);
+        self.rings.items[i] = ring;
+    } else {
+        self.rings.appendAssumeCapacity(ring);
+    }
+
+    log.debug("{s} {s}: {d} rows of {d} floats", .{ @tagName(kind), @tagName(channel), rows, size });
+}
+
+pub fn get(self: *const History, kind: Kind, channel: AudioSplixer.Channel) ?*const Ring {
+    for (self.rings.items) |*ring| {
+        if (ring.kind == kind and ring.channel == channel) return ring;
+    }
+    return null;
+}
+
+/// Add a row to every ring whose result changed in the frame `analyzer` just
+/// analyzed, evaluating lazy jobs
+pub fn update(self: *History, analyzer: *AudioAnalyzer) void {
+    for (self.rings.items) |*ring| {
+        const job = sourceJob(ring.kind, ring.channel);
+        analyzer.require(job);
+
+        const stamp = analyzer.stamps.get(job);
+        if (stamp.sequence == ring.stamp.sequence) {
+            continue;
+        }
+
+        ring.head = (ring.head + 1) % ring.rows;
+        ring.count = @min(ring.count + 1, ring.rows);
+        ring.stamp = stamp;
+
+        const row = ring.data[ring.head * ring.stride ..][0..ring.size];
+        @memcpy(row, source(analyzer, ring.kind, ring.channel).?);
+    }
+}
+
+fn sourceJob(kind: Kind, channel: AudioSplixer.Channel) Job {
+    return switch (kind) {
+        .spectrum => AudioAnalyzer.spectrumJob(channel),
+        .chromagram => switch (channel) {
+            .center => .chroma_center,
+            .left => .chroma_left,
+            .right => .chroma_right,
+            // Never requested, `source` has no side chromagram
+            .side => unreachable,
+        },
+    };
+}
+
+/// The current result a row copies, null if it is not enabled
+fn source(analyzer: *AudioAnalyzer, kind: Kind, channel: AudioSplixer.Channel) ?[]const f32 {
+    return switch (kind) {
+        .spectrum => if (analyzer.builtinSpectrum(channel)) |fft| fft.read() else null,
+        .chromagram => switch (channel) {
+            .center => if (analyzer.chroma_center) |*chroma| &chroma.chroma else null,
+            .left => if (analyzer.chroma_left) |*chroma| &chroma.chroma else null,
+            .right => if (analyzer.chroma_right) |*chroma| &chroma.chroma else null,
+            .side => null,
+        },
+    };
+}
@@ -0,0 +1,211 @@
+//!
+//! Copies of every enabled analysis result, published once per frame into a
+//! triple buffer so a visualizer reads one consistent frame with one call.
+//! Publishing starts with the first `read` and evaluates every lazy job, so
+//! visualizers that never ask pay nothing.
+//!
+
+const std = @import("std");
+const Snapshot = @This();
+
+const bob = @import("bob_api.zig");
+const AudioAnalyzer = @import("audio/AudioAnalyzer.zig");
+const AudioSplixer = @import("audio/AudioSplixer.zig");
+const Beat = @import("audio/Beat.zig");
+const FFT = @import("audio/fft.zig").FastFourierTransform;
+const Job = AudioAnalyzer.Job;
+
+const Slot = struct {
+    data: bob.bob_snapshot,
+
+    /// Backing memory of the buffers in `data`, empty for disabled channels
+    time: std.EnumArray(AudioSplixer.Channel, []f32),
+    frequency: std.EnumArray(AudioSplixer.Channel, []f32),
+    pulse: std.meta.FieldType(Beat, .Eh),
+};
+
+/// Set on `middle` when it holds a frame the reader has not taken yet
+const fresh: u8 = 4;
+
+slots: [3]Slot,
+
+/// Slot the publisher writes
+back: u8,
+
+/// Slot handed between publisher and reader, with the `fresh` bit
+middle: std.atomic.Value(u8),
+
+/// Slot the reader holds
+front: u8,
+
+/// A visualizer has read a snapshot since the last `configure`
+wanted: std.atomic.Value(bool),
+
+pub fn init() Snapshot {
+    var self: Snapshot = undefined;
+    for (&self.slots) |*slot| {
+        slot.data = std.mem.zeroes(bob.bob_snapshot);
+        slot.time = std.EnumArray(AudioSplixer.Channel, []f32).initFill(&.{});
+        slot.frequency = std.EnumArray(AudioSplixer.Channel, []f32).initFill(&.{});
+    }
+    self.back = 0;
+    self.middle = std.atomic.Value(u8).init(1);
+    self.front = 2;
+    self.wanted = std.atomic.Value(bool).init(false);
+    return self;
+}
+
+pub fn deinit(self: *Snapshot, allocator: std.mem.Allocator) void {
+    self.free(allocator);
+    self.* = undefined;
+}
+
+/// Size the slots for the analyses `analyzer` was configured with
+pub fn configure(self: *Snapshot, analyzer: *const AudioAnalyzer, allocator: std.mem.Allocator) !void {
+    self.free(allocator);
+    self.wanted.store(false, .release);
+
+    for (&self.slots) |*slot| {
+        slot.data = std.mem.zeroes(bob.bob_snapshot);
+
+        for (std.enums.values(AudioSplixer.Channel)) |channel| {
+            if (analyzer.splixer.channels.contains(channel)) {
+                slot.time.set(channel, try allocator.alloc(f32, analyzer.splixer.capacity));
+            }
+            if (spectrum(analyzer, channel)) |fft| {
+                slot.frequency.set(channel, try allocator.alloc(f32, fft.outputLength()));
+            }
+        }
+    }
+}
+
+fn free(self: *Snapshot, allocator: std.mem.Allocator) void {
+    for (&self.slots) |*slot| {
+        for (&slot.time.values) |*buffer| {
+            allocator.free(buffer.*);
+            buffer.* = &.{};
+        }
+        for (&slot.frequency.values) |*buffer| {
+            allocator.free(buffer.*);
+            buffer.* = &.{};
+        }
+        slot.data = std.mem.zeroes(bob.bob_snapshot);
+    }
+}
+
+/// The newest published frame, valid until the next call
+pub fn read(self: *Snapshot) *const bob.bob_snapshot {
+    self.wanted.store(true, .release);
+
+    if (self.middle.load(.acquire) & fresh != 0) {
+        self.front = self.middle.swap(self.front, .acq_rel) & ~fresh;
+    }
+    return &self.slots[self.front].data;
+}
+
+/// Copy the results of the frame `analyzer` just analyzed, evaluating lazy jobs
+pub fn publish(self: *Snapshot, analyzer: *AudioAnalyzer) void {
+    const slot = &self.slots[self.back];
+    const data = &slot.data;
+
+    data.* = std.mem.zeroes(bob.bob_snapshot);
+    data.sequence = analyzer.frame_count;
+    data.quality_tier = @intFromEnum(analyzer.quality);
+
+    for (std.enums.values(AudioSplixer.Channel)) |channel| {
+        const index = channelIndex(channel);
+
+        const time = slot.time.get(channel);
+        if (time.len > 0) {
+            const samples = switch (channel) {
+                .center => analyzer.splixer.getCenter(),
+                .left => analyzer.splixer.getLeft(),
+                .right => analyzer.splixer.getRight(),
+                .side => analyzer.splixer.getSide(),
+            };
+            @memcpy(time[0..samples.len], samples);
+            data.time_data[index] = .{ .ptr = time.ptr, .size = samples.len };
+        }
+
+        const frequency = slot.frequency.get(channel);
+        if (frequency.len > 0) {
+            analyzer.require(spectrumJob(channel));
+            @memcpy(frequency, spectrum(analyzer, channel).?.read());
+            data.frequency_data[index] = .{ .ptr = frequency.ptr, .size = frequency.len };
+        }
+    }
+
+    inline for (.{
+        .{ bob.BOB_MONO_CHANNEL, Job.chroma_center, "chroma_center", Job.key_center, "key_center", Job.breaks_center, "breaks_center" },
+        .{ bob.BOB_LEFT_CHANNEL, Job.chroma_left, "chroma_left", Job.key_left, "key_left", Job.breaks_left, "breaks_left" },
+        .{ bob.BOB_RIGHT_CHANNEL, Job.chroma_right, "chroma_right", Job.key_right, "key_right", Job.breaks_right, "breaks_right" },
+    }) |entry| {
+        const index = entry[0];
+
+        if (analyzer.live.contains(entry[1])) {
+            analyzer.require(entry[1]);
+            data.chromagram[index] = @field(analyzer, entry[2]).?.chroma;
+        }
+        if (analyzer.live.contains(entry[3])) {
+            analyzer.require(entry[3]);
+            const result = @field(analyzer, entry[4]).result;
+            data.key[index] = .{
+                .pitch_class = @intCast(result.pitch_class),
+                .type = @intCast(result.key_type),
+                .confidence = result.confidence,
+            };
+        }
+        if (analyzer.live.contains(entry[5])) {
+            data.in_break[index] = @intFromBool(@field(analyzer, entry[6]).in_break);
+        }
+    }
+
+    if (analyzer.beat_center) |*beat| {
+        @memcpy(slot.pulse[0..beat.num_bins], beat.Eh[0..beat.num_bins]);
+        data.pulse_data = .{ .ptr = &slot.pulse, .size = beat.num_bins };
+    }
+    if (analyzer.tempo_center) |*tempo| {
+        data.tempo = tempo.get_bpm();
+    }
+    if (analyzer.mood_center != null) {
+        analyzer.require(.mood_center);
+        data.mood = @intFromEnum(analyzer.mood_center.?.read());
+    }
+
+    // Mid is the mono signal under its stereo name
+    data.time_data[bob.BOB_MID_CHANNEL] = data.time_data[bob.BOB_MONO_CHANNEL];
+    data.frequency_data[bob.BOB_MID_CHANNEL] = data.frequency_data[bob.BOB_MONO_CHANNEL];
+    data.chromagram[bob.BOB_MID_CHANNEL] = data.chromagram[bob.BOB_MONO_CHANNEL];
+    data.key[bob.BOB_MID_CHANNEL] = data.key[bob.BOB_MONO_CHANNEL];
+    data.in_break[bob.BOB_MID_CHANNEL] = data.in_break[bob.BOB_MONO_CHANNEL];
+
+    self.back = self.middle.swap(self.back | fresh, .acq_rel) & ~fresh;
+}
+
+fn channelIndex(channel: AudioSplixer.Channel) usize {
+    return switch (channel) {
+        .center => bob.BOB_MONO_CHANNEL,
+        .left => bob.BOB_LEFT_CHANNEL,
+        .right => bob.BOB_RIGHT_CHANNEL,
+        .side => bob.BOB_SIDE_CHANNEL,
+    };
+}
+
+fn spectrumJob(channel: AudioSplixer.Channel) Job {
+    return switch (channel) {
+        .center => .spectrum_center,
+        .left => .spectrum_left,
+        .right => .spectrum_right,
+        .side => .spectrum_side,
+    };
+}
+
+fn spectrum(analyzer: *const AudioAnalyzer, channel: AudioSplixer.Channel) ?*const FFT {
+    const field = switch (channel) {
+        .center => &analyzer.spectral_analyzer_center,
+        .left => &analyzer.spectral_analyzer_left,
+        .right => &analyzer.spectral_analyzer_right,
+        .side => &analyzer.spectral_analyzer_side,
+    };
+    return if (field.*) |*fft| fft else null;
+}
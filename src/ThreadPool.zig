@@ -0,0 +1,485 @@
+//!
+//! Fixed set of worker threads with one task queue each. Workers take their
+//! own newest task first and steal the oldest task of another queue when idle.
+//! Background tasks run only once no frame task is left.
+//!
+
+const std = @import("std");
+const ThreadPool = @This();
+
+const trace = @import("trace.zig");
+const sched = @import("sched.zig");
+const CountingAllocator = @import("CountingAllocator.zig");
+
+const log = std.log.scoped(.pool);
+
+/// Upper bound on worker threads, analysis graphs are small
+pub const max_workers = 8;
+
+/// Queued tasks per worker before `spawn` runs tasks inline
+const queue_capacity = 64;
+
+/// Embed in a struct and recover it with `@fieldParentPtr` in `run`
+pub const Task = struct {
+    run: *const fn (task: *Task) void,
+};
+
+/// Background job that is pending at most once. Submitting while it is queued
+/// does nothing and submitting while it runs runs it once more afterwards, so
+/// it always works on the newest input and never on a backlog.
+pub const Latest = struct {
+    const State = enum(u8) { idle, queued, running, rerun };
+
+    task: Task = .{ .run = runLatest },
+    run: *const fn (latest: *Latest) void,
+    state: std.atomic.Value(State) = std.atomic.Value(State).init(.idle),
+
+    pub fn init(run: *const fn (latest: *Latest) void) Latest {
+        return Latest{ .run = run };
+    }
+};
+
+const Queue = struct {
+    mutex: std.Thread.Mutex = .{},
+    tasks: std.BoundedArray(*Task, queue_capacity) = .{},
+
+    fn push(self: *Queue, task: *Task) bool {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        self.tasks.append(task) catch return false;
+        return true;
+    }
+
+    /// Newest task, for the owning worker
+    fn pop(self: *Queue) ?*Task {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        return self.tasks.popOrNull();
+    }
+
+    /// Oldest task, for other workers
+    fn steal(self: *Queue) ?*Task {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        if (self.tasks.len == 0) {
+            return null;
+        }
+        return self.tasks.orderedRemove(0);
+    }
+
+    fn remove(self: *Queue, task: *Task) bool {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        const index = std.mem.indexOfScalar(*Task, self.tasks.slice(), task) orelse return false;
+        _ = self.tasks.orderedRemove(index);
+        return true;
+    }
+};
+
+/// Index of the calling worker's queue, null outside the pool
+threadlocal var worker_index: ?usize = null;
+
+threads: []std.Thread,
+
+/// One queue per worker, plus a last one for threads outside the pool
+queues: []Queue,
+
+/// `Latest` jobs waiting for an idle worker
+background: Queue,
+
+/// Tasks pushed but not yet taken, used to put idle workers to sleep
+queued: std.atomic.Value(usize),
+
+sleep_mutex: std.Thread.Mutex,
+sleep_condition: std.Thread.Condition,
+
+/// Signaled by `finish` for threads in `wait`, under `sleep_mutex`
+done_condition: std.Thread.Condition,
+shutdown: bool,
+
+/// Spawn `worker_count` threads, zero runs every task on the thread that waits for it
+pub fn init(worker_count: usize, allocator: std.mem.Allocator) !*ThreadPool {
+    const self = try allocator.create(ThreadPool);
+    errdefer allocator.destroy(self);
+
+    const queues = try allocator.alloc(Queue, worker_count + 1);
+    errdefer allocator.free(queues);
+    @memset(queues, .{});
+
+    const threads = try allocator.alloc(std.Thread, worker_count);
+    errdefer allocator.free(threads);
+
+    self.* = ThreadPool{
+        .threads = threads[0..0],
+        .queues = queues,
+        .background = .{},
+        .queued = std.atomic.Value(usize).init(0),
+        .sleep_mutex = .{},
+        .sleep_condition = .{},
+        .done_condition = .{},
+        .shutdown = false,
+    };
+    errdefer self.join();
+
+    for (threads, 0..) |*thread, i| {
+        thread.* = try std.Thread.spawn(.{}, workerMain, .{ self, i });
+        self.threads.len += 1;
+    }
+
+    log.info("started {d} workers", .{worker_count});
+
+    return self;
+}
+
+pub fn deinit(self: *ThreadPool, allocator: std.mem.Allocator) void {
+    self.join();
+    allocator.free(self.threads.ptr[0 .. self.queues.len - 1]);
+    allocator.free(self.queues);
+    allocator.destroy(self);
+}
+
+/// Worker count for this machine, leaving the calling thread to help out
+pub fn defaultWorkerCount() usize {
+    const cpus = std.Thread.getCpuCount() catch 1;
+    return @min(cpus, max_workers + 1) - 1;
+}
+
+fn join(self: *ThreadPool) void {
+    self.sleep_mutex.lock();
+    self.shutdown = true;
+    self.sleep_condition.broadcast();
+    self.sleep_mutex.unlock();
+
+    for (self.threads) |thread| {
+        thread.join();
+    }
+}
+
+/// Queue a task. It may run on any worker, or on a thread in `wait`.
+pub fn spawn(self: *ThreadPool, task: *Task) void {
+    const index = worker_index orelse self.queues.len - 1;
+
+    // Counted before pushing so it never drops below the number of queued tasks
+    _ = self.queued.fetchAdd(1, .release);
+
+    if (!self.queues[index].push(task)) {
+        _ = self.queued.fetchSub(1, .release);
+        task.run(task);
+        return;
+    }
+
+    self.sleep_mutex.lock();
+    self.sleep_condition.signal();
+    self.sleep_mutex.unlock();
+}
+
+/// Queue `latest` unless it is already pending. Runs it inline without workers.
+pub fn submit(self: *ThreadPool, latest: *Latest) void {
+    while (true) {
+        const state = latest.state.load(.acquire);
+        const next: Latest.State = switch (state) {
+            .idle => .queued,
+            .running => .rerun,
+            .queued, .rerun => return,
+        };
+        if (latest.state.cmpxchgWeak(state, next, .acq_rel, .acquire) == null) {
+            if (next != .queued) {
+                return;
+            }
+            break;
+        }
+    }
+
+    if (self.threads.len == 0) {
+        latest.task.run(&latest.task);
+        return;
+    }
+
+    _ = self.queued.fetchAdd(1, .release);
+    if (!self.background.push(&latest.task)) {
+        // Each `Latest` is queued at most once, so this only overflows with too many of them
+        _ = self.queued.fetchSub(1, .release);
+        latest.state.store(.idle, .release);
+        log.warn("background queue full, dropping a job", .{});
+        return;
+    }
+
+    self.sleep_mutex.lock();
+    self.sleep_condition.signal();
+    self.sleep_mutex.unlock();
+}
+
+/// Dequeue `latest` or wait for its current run to finish, before its owner is freed
+pub fn cancel(self: *ThreadPool, latest: *Latest) void {
+    while (true) {
+        switch (latest.state.load(.acquire)) {
+            .idle => return,
+            .queued => if (self.background.remove(&latest.task)) {
+                _ = self.queued.fetchSub(1, .release);
+                latest.state.store(.idle, .release);
+                return;
+            },
+            .rerun => {
+                _ = latest.state.cmpxchgWeak(.rerun, .running, .acq_rel, .acquire);
+            },
+            .running => {},
+        }
+        std.atomic.spinLoopHint();
+    }
+}
+
+fn runLatest(task: *Task) void {
+    const latest: *Latest = @fieldParentPtr("task", task);
+    latest.state.store(.running, .release);
+
+    while (true) {
+        latest.run(latest);
+
+        if (latest.state.cmpxchgStrong(.running, .idle, .acq_rel, .acquire) == null) {
+            return;
+        }
+        // Submitted again while running
+        latest.state.store(.running, .release);
+    }
+}
+
+/// Mark a task of `wait_group` as done, waking `wait` when it was the last one.
+/// Tasks waited for with `wait` have to finish through this.
+pub fn finish(self: *ThreadPool, wait_group: *std.Thread.WaitGroup) void {
+    wait_group.finish();
+    if (!wait_group.isDone()) {
+        return;
+    }
+
+    self.sleep_mutex.lock();
+    self.done_condition.broadcast();
+    self.sleep_mutex.unlock();
+}
+
+/// Run queued tasks until `wait_group` is done, sleeping once none is left to take
+pub fn wait(self: *ThreadPool, wait_group: *std.Thread.WaitGroup) void {
+    while (!wait_group.isDone()) {
+        if (self.take(self.queues.len - 1)) |task| {
+            task.run(task);
+            continue;
+        }
+
+        // The rest is running on workers, which spawn their dependents into their own queues
+        self.sleep_mutex.lock();
+        defer self.sleep_mutex.unlock();
+
+        while (!wait_group.isDone()) {
+            self.done_condition.wait(&self.sleep_mutex);
+        }
+    }
+}
+
+fn take(self: *ThreadPool, own: usize) ?*Task {
+    const task = self.queues[own].pop() orelse blk: {
+        for (1..self.queues.len) |offset| {
+            const victim = (own + offset) % self.queues.len;
+            if (self.queues[victim].steal()) |stolen| {
+                break :blk stolen;
+            }
+        }
+        return null;
+    };
+
+    _ = self.queued.fetchSub(1, .acquire);
+    return task;
+}
+
+fn takeBackground(self: *ThreadPool) ?*Task {
+    const task = self.background.steal() orelse return null;
+    _ = self.queued.fetchSub(1, .acquire);
+    return task;
+}
+
+fn workerMain(self: *ThreadPool, index: usize) void {
+    worker_index = index;
+    trace.nameThread("pool worker");
+    sched.apply(.analysis);
+
+    // Tasks run inside the frame loop
+    CountingAllocator.enter();
+
+    while (true) {
+        if (self.take(index) orelse self.takeBackground()) |task| {
+            task.run(task);
+            continue;
+        }
+
+        self.sleep_mutex.lock();
+        defer self.sleep_mutex.unlock();
+
+        while (self.queued.load(.acquire) == 0 and !self.shutdown) {
+            self.sleep_condition.wait(&self.sleep_mutex);
+        }
+
+        if (self.shutdown) {
+            return;
+        }
+    }
+}
+
+/// Counts its runs, each run blocks until `release` is set
+const TestJob = struct {
+    latest: Latest = Latest.init(run),
+    runs: std.atomic.Value(u32) = std.atomic.Value(u32).init(0),
+    running: std.Thread.ResetEvent = .{},
+    release: std.Thread.ResetEvent = .{},
+
+    fn run(latest: *Latest) void {
+        const self: *TestJob = @fieldParentPtr("latest", latest);
+        self.running.set();
+        self.release.wait();
+        _ = self.runs.fetchAdd(1, .release);
+    }
+
+    fn state(self: *const TestJob) Latest.State {
+        return self.latest.state.load(.acquire);
+    }
+
+    fn waitIdle(self: *const TestJob, runs: u32) void {
+        while (self.runs.load(.acquire) < runs or self.state() != .idle) {
+            std.Thread.yield() catch {};
+        }
+    }
+};
+
+/// Keeps a worker busy until `release` is set
+const Blocker = struct {
+    task: Task = .{ .run = run },
+    started: std.Thread.ResetEvent = .{},
+    release: std.Thread.ResetEvent = .{},
+
+    fn run(task: *Task) void {
+        const self: *Blocker = @fieldParentPtr("task", task);
+        self.started.set();
+        self.release.wait();
+    }
+};
+
+test "latest runs inline without workers" {
+    const pool = try ThreadPool.init(0, std.testing.allocator);
+    defer pool.deinit(std.testing.allocator);
+
+    var job = TestJob{};
+    job.release.set();
+
+    pool.submit(&job.latest);
+    try std.testing.expectEqual(1, job.runs.load(.acquire));
+    try std.testing.expectEqual(.idle, job.state());
+
+    pool.cancel(&job.latest);
+    try std.testing.expectEqual(.idle, job.state());
+}
+
+test "latest submitted while queued runs once" {
+    const pool = try ThreadPool.init(1, std.testing.allocator);
+    defer pool.deinit(std.testing.allocator);
+
+    var blocker = Blocker{};
+    pool.spawn(&blocker.task);
+    blocker.started.wait();
+
+    var job = TestJob{};
+    job.release.set();
+
+    pool.submit(&job.latest);
+    pool.submit(&job.latest);
+    try std.testing.expectEqual(.queued, job.state());
+
+    blocker.release.set();
+    job.waitIdle(1);
+    try std.testing.expectEqual(1, job.runs.load(.acquire));
+}
+
+test "latest submitted while running runs once more" {
+    const pool = try ThreadPool.init(1, std.testing.allocator);
+    defer pool.deinit(std.testing.allocator);
+
+    var job = TestJob{};
+    pool.submit(&job.latest);
+    job.running.wait();
+    try std.testing.expectEqual(.running, job.state());
+
+    pool.submit(&job.latest);
+    pool.submit(&job.latest);
+    try std.testing.expectEqual(.rerun, job.state());
+
+    job.release.set();
+    job.waitIdle(2);
+    try std.testing.expectEqual(2, job.runs.load(.acquire));
+}
+
+test "cancel dequeues a queued latest" {
+    const pool = try ThreadPool.init(1, std.testing.allocator);
+    defer pool.deinit(std.testing.allocator);
+
+    var blocker = Blocker{};
+    pool.spawn(&blocker.task);
+    blocker.started.wait();
+
+    var job = TestJob{};
+    job.release.set();
+    pool.submit(&job.latest);
+
+    pool.cancel(&job.latest);
+    try std.testing.expectEqual(.idle, job.state());
+    try std.testing.expectEqual(0, pool.background.tasks.len);
+
+    blocker.release.set();
+    try std.testing.expectEqual(0, job.runs.load(.acquire));
+}
+
+test "cancel waits for a running latest" {
+    const pool = try ThreadPool.init(1, std.testing.allocator);
+    defer pool.deinit(std.testing.allocator);
+
+    var job = TestJob{};
+    pool.submit(&job.latest);
+    job.running.wait();
+
+    const releaser = try std.Thread.spawn(.{}, struct {
+        fn release(j: *TestJob) void {
+            std.time.sleep(10 * std.time.ns_per_ms);
+            j.release.set();
+        }
+    }.release, .{&job});
+    defer releaser.join();
+
+    pool.cancel(&job.latest);
+    try std.testing.expectEqual(1, job.runs.load(.acquire));
+    try std.testing.expectEqual(.idle, job.state());
+}
+
+test "cancel drops the rerun of a running latest" {
+    const pool = try ThreadPool.init(1, std.testing.allocator);
+    defer pool.deinit(std.testing.allocator);
+
+    var job = TestJob{};
+    pool.submit(&job.latest);
+    job.running.wait();
+    pool.submit(&job.latest);
+    try std.testing.expectEqual(.rerun, job.state());
+
+    // Released only once cancel has turned the rerun back into a plain run
+    const releaser = try std.Thread.spawn(.{}, struct {
+        fn release(j: *TestJob) void {
+            while (j.state() == .rerun) {
+                std.Thread.yield() catch {};
+            }
+            j.release.set();
+        }
+    }.release, .{&job});
+    defer releaser.join();
+
+    pool.cancel(&job.latest);
+    try std.testing.expectEqual(1, job.runs.load(.acquire));
+    try std.testing.expectEqual(.idle, job.state());
+}
@@ -0,0 +1,97 @@
+//!
+//! Bump allocator over one block in which every allocation starts on a
+//! cache line. Individual frees do nothing, the block is released at once.
+//!
+
+const std = @import("std");
+const AlignedArena = @This();
+
+/// Cache line size of the targets we run on
+pub const alignment = 64;
+
+buffer: []align(alignment) u8 = &[_]u8{},
+end: usize = 0,
+
+pub fn init(size: usize, allocator: std.mem.Allocator) !AlignedArena {
+    return AlignedArena{
+        .buffer = try allocator.alignedAlloc(u8, alignment, size),
+    };
+}
+
+pub fn deinit(self: *AlignedArena, allocator: std.mem.Allocator) void {
+    allocator.free(self.buffer);
+    self.* = .{};
+}
+
+/// Forget every allocation, keeping the block
+pub fn reset(self: *AlignedArena) void {
+    self.end = 0;
+}
+
+pub fn allocator(self: *AlignedArena) std.mem.Allocator {
+    return .{
+        .ptr = self,
+        .vtable = &.{
+            .alloc = alloc,
+            .resize = resize,
+            .free = free,
+        },
+    };
+}
+
+fn alloc(ctx: *anyopaque, len: usize, ptr_align: u8, _: usize) ?[*]u8 {
+    const self: *AlignedArena = @ptrCast(@alignCast(ctx));
+    const start = std.mem.alignForward(usize, self.end, @max(alignment, @as(usize, 1) << @intCast(ptr_align)));
+
+    if (start + len > self.buffer.len) {
+        return null;
+    }
+
+    self.end = start + len;
+    return self.buffer.ptr + start;
+}
+
+fn resize(_: *anyopaque, buf: []u8, _: u8, new_len: usize, _: usize) bool {
+    return new_len <= buf.len;
+}
+
+fn free(_: *anyopaque, _: []u8, _: u8, _: usize) void {}
+
+/// Forwards to another allocator while summing what an `AlignedArena` would need
+/// for the same allocations, so an arena can be sized by a trial run.
+pub const Planner = struct {
+    backing: std.mem.Allocator,
+    size: usize = 0,
+
+    pub fn allocator(self: *Planner) std.mem.Allocator {
+        return .{
+            .ptr = self,
+            .vtable = &.{
+                .alloc = planAlloc,
+                .resize = planResize,
+                .free = planFree,
+            },
+        };
+    }
+
+    fn planAlloc(ctx: *anyopaque, len: usize, ptr_align: u8, ret_addr: usize) ?[*]u8 {
+        const self: *Planner = @ptrCast(@alignCast(ctx));
+        self.size += std.mem.alignForward(usize, len, alignment);
+        return self.backing.rawAlloc(len, ptr_align, ret_addr);
+    }
+
+    fn planResize(ctx: *anyopaque, buf: []u8, buf_align: u8, new_len: usize, ret_addr: usize) bool {
+        const self: *Planner = @ptrCast(@alignCast(ctx));
+
+        // The arena only shrinks in place
+        if (new_len > buf.len) {
+            return false;
+        }
+        return self.backing.rawResize(buf, buf_align, new_len, ret_addr);
+    }
+
+    fn planFree(ctx: *anyopaque, buf: []u8, buf_align: u8, ret_addr: usize) void {
+        const self: *Planner = @ptrCast(@alignCast(ctx));
+        self.backing.rawFree(buf, buf_align, ret_addr);
+    }
+};
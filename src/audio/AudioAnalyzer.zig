@@ -4,6 +4,7 @@ const AudioAnalyzer = @This();
 const Config = @import("Config.zig");
 const AudioSplixer = @import("AudioSplixer.zig");
 const FFT = @import("fft.zig").FastFourierTransform;
+const WindowFunction = @import("fft.zig").WindowFunction;
 const Flags = @import("../flags.zig").Flags;
 const Chroma = @import("Chroma.zig");
 const Breaks = @import("Breaks.zig");
@@ -11,144 +12,820 @@ const Beat = @import("Beat.zig");
 const Tempo = @import("Tempo.zig");
 const Key = @import("Key.zig");
 const mood = @import("mood.zig");
+const ThreadPool = @import("../ThreadPool.zig");
+const AlignedArena = @import("AlignedArena.zig");
+const Gate = @import("Gate.zig");
+const trace = @import("../trace.zig");
 
+/// One unit of analysis work, run as a task on the pool
+pub const Job = enum {
+    spectrum_center,
+    spectrum_left,
+    spectrum_right,
+    spectrum_side,
+    chroma_center,
+    chroma_left,
+    chroma_right,
+    key_center,
+    key_left,
+    key_right,
+    breaks_center,
+    breaks_left,
+    breaks_right,
+    beat_center,
+    tempo_center,
+    mood_center,
+
+    /// Spectra visualizers asked for with `requestSpectrum`, on any channel
+    requested_spectra,
+
+    /// Jobs whose results this job reads. Every job reads the split channels,
+    /// which are ready before any job starts.
+    fn dependencies(self: Job) []const Job {
+        return switch (self) {
+            .key_center => &.{.chroma_center},
+            .key_left => &.{.chroma_left},
+            .key_right => &.{.chroma_right},
+            else => &.{},
+        };
+    }
+
+    fn pendingDependencies(self: Job, live: std.EnumSet(Job)) u8 {
+        var count: u8 = 0;
+        for (self.dependencies()) |dependency| {
+            count += @intFromBool(live.contains(dependency));
+        }
+        return count;
+    }
+
+    /// Jobs that only need their input fed every frame and can be evaluated on demand.
+    /// Beat, tempo and breaks track onsets across frames, so they always run.
+    fn isLazy(self: Job) bool {
+        return switch (self) {
+            .spectrum_center, .spectrum_left, .spectrum_right, .spectrum_side => true,
+            .chroma_center, .chroma_left, .chroma_right => true,
+            .key_center, .key_left, .key_right => true,
+            .mood_center, .requested_spectra => true,
+            .breaks_center, .breaks_left, .breaks_right => false,
+            .beat_center, .tempo_center => false,
+        };
+    }
+
+    /// Jobs the silence gate suspends. Breaks and tempo follow the silence itself.
+    fn isSuspendable(self: Job) bool {
+        return switch (self) {
+            .breaks_center, .breaks_left, .breaks_right, .tempo_center => false,
+            else => true,
+        };
+    }
+
+    /// Split channel the job reads, requested spectra read the channels of their requests
+    fn channel(self: Job) AudioSplixer.Channel {
+        return switch (self) {
+            .spectrum_left, .chroma_left, .key_left, .breaks_left => .left,
+            .spectrum_right, .chroma_right, .key_right, .breaks_right => .right,
+            .spectrum_side => .side,
+            else => .center,
+        };
+    }
+
+    fn enabled(self: Job, flags: Flags) bool {
+        return switch (self) {
+            .spectrum_center => flags.frequency_mono,
+            .spectrum_left, .spectrum_right => flags.frequency_stereo,
+            .spectrum_side => flags.frequency_side,
+            .chroma_center => flags.chromagram_mono,
+            .chroma_left, .chroma_right => flags.chromagram_stereo,
+            .key_center => flags.key_mono,
+            .key_left, .key_right => flags.key_stereo,
+            .breaks_center => flags.breaks_mono,
+            .breaks_left, .breaks_right => flags.breaks_stereo,
+            .beat_center => flags.pulse_mono,
+            .tempo_center => flags.tempo_mono,
+            .mood_center => flags.mood_mono,
+            // Enabled by `requestSpectrum` instead
+            .requested_spectra => false,
+        };
+    }
+};
+
+/// How much work the analysis does per frame, lowered by `Governor` under load
+pub const Quality = enum(u8) {
+    /// Everything, every frame
+    full,
+
+    /// Fewer chroma partials and octaves, key and mood every second frame
+    reduced,
+
+    /// Also skip the left and right passes, key and mood every fourth frame
+    low,
+
+    pub fn lower(self: Quality) ?Quality {
+        return if (self == .low) null else @enumFromInt(@intFromEnum(self) + 1);
+    }
+
+    pub fn higher(self: Quality) ?Quality {
+        return if (self == .full) null else @enumFromInt(@intFromEnum(self) - 1);
+    }
+
+    /// Frames between key and mood updates
+    fn interval(self: Quality) u64 {
+        return switch (self) {
+            .full => 1,
+            .reduced => 2,
+            .low => 4,
+        };
+    }
+
+    fn maxPartials(self: Quality) usize {
+        return switch (self) {
+            .full => std.math.maxInt(usize),
+            .reduced => 2,
+            .low => 1,
+        };
+    }
+
+    fn maxOctaves(self: Quality) usize {
+        return switch (self) {
+            .full => std.math.maxInt(usize),
+            .reduced => 5,
+            .low => 4,
+        };
+    }
+
+    /// Whether `job` is not run at all, keeping its last result
+    fn skips(self: Quality, job: Job) bool {
+        return self == .low and (job.channel() == .left or job.channel() == .right);
+    }
+
+    /// Whether `job` is fed but not evaluated this frame, keeping its last result
+    fn holds(self: Quality, job: Job, frame: u64) bool {
+        return switch (job) {
+            .key_center, .key_left, .key_right, .mood_center => frame % self.interval() != 0,
+            else => false,
+        };
+    }
+};
+
+const Node = struct {
+    task: ThreadPool.Task,
+    job: Job,
+    analyzer: *AudioAnalyzer,
+
+    /// Live dependencies that have not finished this frame
+    waiting: std.atomic.Value(u8),
+
+    fn run(task: *ThreadPool.Task) void {
+        const node: *Node = @fieldParentPtr("task", task);
+        const self = node.analyzer;
+
+        const z = trace.zone(@tagName(node.job));
+        self.feed(node.job);
+        if (self.evaluated.contains(node.job)) {
+            self.evaluate(node.job);
+
+            // Tempo publishes in the background, see `Tempo.get_graph_stamp`
+            if (node.job != .tempo_center) {
+                self.stamps.set(node.job, self.frame);
+            }
+        }
+        z.end();
+
+        // Release dependents whose last dependency this was
+        for (std.enums.values(Job)) |job| {
+            const dependent = self.nodes.getPtr(job);
+            if (!self.frame_jobs.contains(job) or std.mem.indexOfScalar(Job, job.dependencies(), node.job) == null) {
+                continue;
+            }
+            if (dependent.waiting.fetchSub(1, .acq_rel) == 1) {
+                self.pool.?.spawn(&dependent.task);
+            }
+        }
+
+        self.pool.?.finish(&self.frame_done);
+    }
+};
+
+/// Analyzers are null until a visualizer enables them, see `configure`
 splixer: AudioSplixer,
-spectral_analyzer_left: FFT,
-spectral_analyzer_right: FFT,
-spectral_analyzer_center: FFT,
-chroma_left: Chroma,
-chroma_right: Chroma,
-chroma_center: Chroma,
+gate: Gate,
+spectral_analyzer_left: ?FFT,
+spectral_analyzer_right: ?FFT,
+spectral_analyzer_center: ?FFT,
+spectral_analyzer_side: ?FFT,
+chroma_left: ?Chroma,
+chroma_right: ?Chroma,
+chroma_center: ?Chroma,
 breaks_left: Breaks,
 breaks_right: Breaks,
 breaks_center: Breaks,
 key_left: Key,
 key_right: Key,
 key_center: Key,
-beat_center: Beat,
-tempo_center: Tempo,
-mood_center: mood.MoodAnalyzer,
+beat_center: ?Beat,
+tempo_center: ?Tempo,
+mood_center: ?mood.MoodAnalyzer,
 
-pub fn init(allocator: std.mem.Allocator) !AudioAnalyzer {
-    var splixer = try AudioSplixer.init(Config.windowSize(), allocator);
-    errdefer splixer.deinit(allocator);
+/// Spectra added by `requestSpectrum` since the last `configure`, indexed by handle
+requested: std.ArrayListUnmanaged(RequestedSpectrum),
 
-    var spectral_analyzer_left = try FFT.init(std.math.log2_int_ceil(usize, 4096), 2, .blackman_nuttall, 0.2, allocator);
-    errdefer spectral_analyzer_left.deinit(allocator);
+/// Jobs whose analyzers exist, these are the ones `analyze` runs
+live: std.EnumSet(Job),
 
-    var spectral_analyzer_right = try FFT.init(std.math.log2_int_ceil(usize, 4096), 2, .blackman_nuttall, 0.2, allocator);
-    errdefer spectral_analyzer_right.deinit(allocator);
+/// State of all live jobs in one block, each job's buffers together and the
+/// jobs in graph order. Kept across `configure` calls while it is big enough.
+arena: AlignedArena,
 
-    var spectral_analyzer_center = try FFT.init(std.math.log2_int_ceil(usize, 4096), 2, .blackman_nuttall, 0.2, allocator);
-    errdefer spectral_analyzer_center.deinit(allocator);
+/// Bytes each job allocates, measured by a trial run the first time it is created
+footprints: std.EnumArray(Job, ?usize),
 
-    var chroma_left = try Chroma.init(allocator, 4096);
-    errdefer chroma_left.deinit(allocator);
+/// Allocate each job's buffers separately instead, set before the first `configure`.
+/// Only useful to compare layouts.
+scattered: bool,
 
-    var chroma_right = try Chroma.init(allocator, 4096);
-    errdefer chroma_right.deinit(allocator);
+/// Started by the first `configure` that enables a job
+pool: ?*ThreadPool,
+worker_count: usize,
 
-    var chroma_center = try Chroma.init(allocator, 4096);
-    errdefer chroma_center.deinit(allocator);
+/// Analyze tempo windows on the pool in the background, set before the first `configure`.
+/// Cleared offline, where each window is analyzed inline so results do not depend on timing.
+background: bool,
+nodes: std.EnumArray(Job, Node),
 
-    var beat_center = try Beat.init(allocator);
-    errdefer beat_center.deinit(allocator);
+/// Completion of the frame being analyzed
+frame_done: std.Thread.WaitGroup,
 
-    var tempo_center = try Tempo.init(allocator);
-    errdefer tempo_center.deinit(allocator);
+/// Evaluate lazy jobs only when their results are read through `require`. Smoothing
+/// in the spectrum and mood then advances per evaluation rather than per frame.
+lazy: bool,
 
-    var mood_center = try mood.MoodAnalyzer.init(allocator);
-    errdefer mood_center.deinit(allocator);
+/// Jobs whose results are up to date for this frame
+evaluated: std.EnumSet(Job),
+
+/// Time `require` spent evaluating since the last `takeRequireTime`
+require_ns: u64,
+
+quality: Quality,
+
+/// Frames analyzed, for updating some jobs less often
+frame_count: u64,
+
+/// When the newest sample passed to the next `analyze` was captured, set by the caller
+capture_time: f64,
+
+/// The frame analyzed last
+frame: Stamp,
+
+/// The frame each job's result was last updated in
+stamps: std.EnumArray(Job, Stamp),
+
+/// Jobs run this frame, live jobs the quality does not hold
+frame_jobs: std.EnumSet(Job),
+
+/// Identifies the analysis frame a result comes from
+pub const Stamp = struct {
+    /// `frame_count` of the frame, results with equal sequences are equal
+    sequence: u64 = 0,
+
+    /// `capture_time` of the frame, in seconds
+    timestamp: f64 = 0.0,
+
+    /// Audio frames the frame covered
+    samples: usize = 0,
+};
+
+/// Spectrum parameters a visualizer can ask for, the defaults are the built-in spectrum
+pub const SpectrumRequest = struct {
+    channel: AudioSplixer.Channel,
+
+    /// Window of 2^size_log2 samples
+    size_log2: u6 = 12,
+
+    /// Zero padded to 2^(size_log2 + padding_log2) samples, giving half as many bins
+    padding_log2: u6 = 2,
+
+    window: WindowFunction = .blackman_nuttall,
+
+    /// Audio frames between evaluations, 0 evaluates every frame
+    hop: usize = 0,
+
+    /// Weight of the newest magnitudes in the moving average
+    smoothing: f32 = 0.2,
+
+    pub const min_size_log2 = 6;
+    pub const max_size_log2 = 14;
+    pub const max_padding_log2 = 4;
+
+    fn isBuiltin(self: SpectrumRequest) bool {
+        return std.meta.eql(self, SpectrumRequest{ .channel = self.channel });
+    }
+};
+
+const RequestedSpectrum = struct {
+    request: SpectrumRequest,
+
+    /// Null when the built-in spectrum of the channel serves the request
+    fft: ?FFT,
+
+    /// Audio frames fed since the last evaluation
+    pending: usize,
+
+    stamp: Stamp,
+};
+
+/// Nothing is allocated until `configure` enables some analysis
+pub fn init(allocator: std.mem.Allocator) !AudioAnalyzer {
+    var splixer = try AudioSplixer.init(Config.windowSize(), allocator);
+    errdefer splixer.deinit(allocator);
+
+    // Inputs are at most half the splixer, leaving room for the pre-roll
+    std.debug.assert(Gate.pre_roll_frames * Config.channel_count + Config.windowSize() <= Config.windowSize() * 2);
+    const gate = try Gate.init(Config.windowSize(), allocator);
 
     return AudioAnalyzer{
         .splixer = splixer,
-        .spectral_analyzer_left = spectral_analyzer_left,
-        .spectral_analyzer_right = spectral_analyzer_right,
-        .spectral_analyzer_center = spectral_analyzer_center,
-        .chroma_left = chroma_left,
-        .chroma_right = chroma_right,
-        .chroma_center = chroma_center,
+        .gate = gate,
+        .spectral_analyzer_left = null,
+        .spectral_analyzer_right = null,
+        .spectral_analyzer_center = null,
+        .spectral_analyzer_side = null,
+        .chroma_left = null,
+        .chroma_right = null,
+        .chroma_center = null,
         .breaks_left = .{},
         .breaks_right = .{},
         .breaks_center = .{},
         .key_left = .{},
         .key_right = .{},
         .key_center = .{},
-        .beat_center = beat_center,
-        .tempo_center = tempo_center,
-        .mood_center = mood_center,
+        .beat_center = null,
+        .tempo_center = null,
+        .mood_center = null,
+        .requested = .{},
+        .live = std.EnumSet(Job).initEmpty(),
+        .arena = .{},
+        .footprints = std.EnumArray(Job, ?usize).initFill(null),
+        .scattered = false,
+        .pool = null,
+        .worker_count = ThreadPool.defaultWorkerCount(),
+        .background = true,
+        .nodes = std.EnumArray(Job, Node).initUndefined(),
+        .frame_done = .{},
+        .lazy = false,
+        .evaluated = std.EnumSet(Job).initEmpty(),
+        .require_ns = 0,
+        .quality = .full,
+        .frame_count = 0,
+        .capture_time = 0.0,
+        .frame = .{},
+        .stamps = std.EnumArray(Job, Stamp).initFill(.{}),
+        .frame_jobs = std.EnumSet(Job).initEmpty(),
     };
 }
 
 pub fn deinit(self: *AudioAnalyzer, allocator: std.mem.Allocator) void {
+    self.releaseSpectra(allocator);
+    self.requested.deinit(allocator);
+    self.destroyAll(allocator);
+    self.arena.deinit(allocator);
+
     self.splixer.deinit(allocator);
-    self.spectral_analyzer_left.deinit(allocator);
-    self.spectral_analyzer_right.deinit(allocator);
-    self.spectral_analyzer_center.deinit(allocator);
-    self.chroma_left.deinit(allocator);
-    self.chroma_right.deinit(allocator);
-    self.chroma_center.deinit(allocator);
-    self.beat_center.deinit(allocator);
-    self.tempo_center.deinit(allocator);
-    self.mood_center.deinit(allocator);
+    self.gate.deinit(allocator);
+    if (self.pool) |pool| pool.deinit(allocator);
     self.* = undefined;
 }
 
-pub fn analyze(self: *AudioAnalyzer, stereo: []const f32, flags: Flags) void {
-    self.splixer.splix(stereo);
+/// Create the analyzers `flags` enables and destroy the rest. Call when a
+/// visualizer is loaded or unloaded, before it reads any analysis. Drops requested spectra.
+pub fn configure(self: *AudioAnalyzer, flags: Flags, allocator: std.mem.Allocator) !void {
+    self.releaseSpectra(allocator);
 
-    const center = self.splixer.getCenter();
-    const left = self.splixer.getLeft();
-    const right = self.splixer.getRight();
+    var wanted = std.EnumSet(Job).initEmpty();
+    for (std.enums.values(Job)) |job| {
+        if (job.enabled(flags)) {
+            for (job.dependencies()) |dependency| {
+                std.debug.assert(dependency.enabled(flags));
+            }
+            wanted.insert(job);
+        }
+    }
+
+    // Only split the channels that are read
+    var channels = std.EnumSet(AudioSplixer.Channel).initEmpty();
+    channels.setPresent(.center, flags.time_mono);
+    channels.setPresent(.left, flags.time_stereo);
+    channels.setPresent(.right, flags.time_stereo);
+    channels.setPresent(.side, flags.time_side);
+    var jobs = wanted.iterator();
+    while (jobs.next()) |job| {
+        channels.insert(job.channel());
+    }
+    self.splixer.channels = channels;
+
+    if (wanted.eql(self.live)) {
+        return;
+    }
+
+    // Jobs share one block, so a different set is laid out from scratch
+    self.destroyAll(allocator);
+
+    if (wanted.count() == 0) {
+        self.arena.deinit(allocator);
+        return;
+    }
+
+    // Jobs like tempo hand background work to the pool
+    if (self.pool == null) {
+        self.pool = try ThreadPool.init(self.worker_count, allocator);
+    }
 
-    if (flags.frequency_mono) {
-        self.spectral_analyzer_center.write(center);
-        self.spectral_analyzer_center.evaluate();
+    if (!self.scattered) {
+        var size: usize = 0;
+        var it = wanted.iterator();
+        while (it.next()) |job| {
+            size += try self.footprint(job, allocator);
+        }
+
+        if (size > self.arena.buffer.len) {
+            self.arena.deinit(allocator);
+            self.arena = try AlignedArena.init(size, allocator);
+        }
+        self.arena.reset();
+    }
+
+    var it = wanted.iterator();
+    while (it.next()) |job| {
+        try self.create(job, self.jobAllocator(allocator));
+        self.live.insert(job);
+    }
+}
+
+pub const RequestError = error{invalid_spectrum_request};
+
+/// Add a spectrum with its own parameters and return its handle, valid until the next
+/// `configure`. Identical requests share one transform, and a request for the built-in
+/// parameters reads the built-in spectrum if its channel has one.
+pub fn requestSpectrum(self: *AudioAnalyzer, request: SpectrumRequest, allocator: std.mem.Allocator) !usize {
+    if (request.size_log2 < SpectrumRequest.min_size_log2 or request.size_log2 > SpectrumRequest.max_size_log2 or
+        request.padding_log2 > SpectrumRequest.max_padding_log2 or !(request.smoothing > 0.0 and request.smoothing <= 1.0))
+    {
+        return RequestError.invalid_spectrum_request;
+    }
+
+    for (self.requested.items, 0..) |requested, handle| {
+        if (std.meta.eql(requested.request, request)) {
+            return handle;
+        }
+    }
+
+    try self.requested.ensureUnusedCapacity(allocator, 1);
+
+    if (request.isBuiltin() and self.live.contains(spectrumJob(request.channel))) {
+        self.requested.appendAssumeCapacity(.{ .request = request, .fft = null, .pending = 0, .stamp = .{} });
+        return self.requested.items.len - 1;
+    }
+
+    if (self.pool == null) {
+        self.pool = try ThreadPool.init(self.worker_count, allocator);
+    }
+
+    const fft = try initSpectrum(request, allocator);
+    self.requested.appendAssumeCapacity(.{ .request = request, .fft = fft, .pending = 0, .stamp = .{} });
+
+    self.splixer.channels.insert(request.channel);
+    self.live.insert(.requested_spectra);
+
+    return self.requested.items.len - 1;
+}
+
+/// Magnitudes of a requested spectrum and the frame they were evaluated in,
+/// evaluating deferred spectra first
+pub fn readSpectrum(self: *AudioAnalyzer, handle: usize) struct { data: []const f32, stamp: Stamp } {
+    const requested = &self.requested.items[handle];
+
+    if (requested.fft) |*fft| {
+        self.require(.requested_spectra);
+        return .{ .data = fft.read(), .stamp = requested.stamp };
+    }
+
+    const job = spectrumJob(requested.request.channel);
+    self.require(job);
+    return .{ .data = self.builtinSpectrum(requested.request.channel).?.read(), .stamp = self.stamps.get(job) };
+}
+
+fn releaseSpectra(self: *AudioAnalyzer, allocator: std.mem.Allocator) void {
+    for (self.requested.items) |*requested| {
+        if (requested.fft) |*fft| fft.deinit(allocator);
+    }
+    self.requested.clearRetainingCapacity();
+    self.live.remove(.requested_spectra);
+    self.frame_jobs.remove(.requested_spectra);
+}
+
+/// Job computing the built-in spectrum of `channel`
+pub fn spectrumJob(channel: AudioSplixer.Channel) Job {
+    return switch (channel) {
+        .center => .spectrum_center,
+        .left => .spectrum_left,
+        .right => .spectrum_right,
+        .side => .spectrum_side,
+    };
+}
+
+/// Built-in spectrum of `channel`, null unless its frequency data is enabled
+pub fn builtinSpectrum(self: *AudioAnalyzer, channel: AudioSplixer.Channel) ?*FFT {
+    const field = switch (channel) {
+        .center => &self.spectral_analyzer_center,
+        .left => &self.spectral_analyzer_left,
+        .right => &self.spectral_analyzer_right,
+        .side => &self.spectral_analyzer_side,
+    };
+    return if (field.*) |*fft| fft else null;
+}
+
+fn jobAllocator(self: *AudioAnalyzer, allocator: std.mem.Allocator) std.mem.Allocator {
+    return if (self.scattered) allocator else self.arena.allocator();
+}
+
+/// Arena bytes `job` needs, found by creating it once
+fn footprint(self: *AudioAnalyzer, job: Job, allocator: std.mem.Allocator) !usize {
+    if (self.footprints.get(job)) |size| {
+        return size;
+    }
+
+    var planner = AlignedArena.Planner{ .backing = allocator };
+    try self.create(job, planner.allocator());
+    self.destroy(job, planner.allocator());
+
+    self.footprints.set(job, planner.size);
+    return planner.size;
+}
+
+fn destroyAll(self: *AudioAnalyzer, allocator: std.mem.Allocator) void {
+    var it = self.live.iterator();
+    while (it.next()) |job| {
+        self.destroy(job, self.jobAllocator(allocator));
+    }
+    self.live = std.EnumSet(Job).initEmpty();
+    self.frame_jobs = std.EnumSet(Job).initEmpty();
+}
+
+fn create(self: *AudioAnalyzer, job: Job, allocator: std.mem.Allocator) !void {
+    switch (job) {
+        .spectrum_center => self.spectral_analyzer_center = try initSpectrum(.{ .channel = .center }, allocator),
+        .spectrum_left => self.spectral_analyzer_left = try initSpectrum(.{ .channel = .left }, allocator),
+        .spectrum_right => self.spectral_analyzer_right = try initSpectrum(.{ .channel = .right }, allocator),
+        .spectrum_side => self.spectral_analyzer_side = try initSpectrum(.{ .channel = .side }, allocator),
+        .chroma_center => self.chroma_center = try Chroma.init(allocator, 4096),
+        .chroma_left => self.chroma_left = try Chroma.init(allocator, 4096),
+        .chroma_right => self.chroma_right = try Chroma.init(allocator, 4096),
+        .key_center => self.key_center = .{},
+        .key_left => self.key_left = .{},
+        .key_right => self.key_right = .{},
+        .breaks_center => self.breaks_center = .{},
+        .breaks_left => self.breaks_left = .{},
+        .breaks_right => self.breaks_right = .{},
+        .beat_center => self.beat_center = try Beat.init(allocator),
+        .tempo_center => self.tempo_center = try Tempo.init(if (self.background) self.pool.? else null, allocator),
+        .mood_center => self.mood_center = try mood.MoodAnalyzer.init(allocator),
+        // Created by `requestSpectrum` with the general allocator, outside the arena
+        .requested_spectra => {},
     }
+}
 
-    if (flags.chromagram_mono) {
-        self.chroma_center.execute(center);
+fn destroy(self: *AudioAnalyzer, job: Job, allocator: std.mem.Allocator) void {
+    switch (job) {
+        .spectrum_center => deinitOptional(FFT, &self.spectral_analyzer_center, allocator),
+        .spectrum_left => deinitOptional(FFT, &self.spectral_analyzer_left, allocator),
+        .spectrum_right => deinitOptional(FFT, &self.spectral_analyzer_right, allocator),
+        .spectrum_side => deinitOptional(FFT, &self.spectral_analyzer_side, allocator),
+        .chroma_center => deinitOptional(Chroma, &self.chroma_center, allocator),
+        .chroma_left => deinitOptional(Chroma, &self.chroma_left, allocator),
+        .chroma_right => deinitOptional(Chroma, &self.chroma_right, allocator),
+        .key_center, .key_left, .key_right => {},
+        .breaks_center, .breaks_left, .breaks_right => {},
+        .beat_center => deinitOptional(Beat, &self.beat_center, allocator),
+        .tempo_center => deinitOptional(Tempo, &self.tempo_center, allocator),
+        .mood_center => deinitOptional(mood.MoodAnalyzer, &self.mood_center, allocator),
+        .requested_spectra => {},
     }
+}
+
+fn initSpectrum(request: SpectrumRequest, allocator: std.mem.Allocator) !FFT {
+    return FFT.init(request.size_log2, request.padding_log2, request.window, request.smoothing, allocator);
+}
 
-    if (flags.breaks_mono) {
-        self.breaks_center.execute(center);
+fn deinitOptional(comptime T: type, analyzer: *?T, allocator: std.mem.Allocator) void {
+    analyzer.*.?.deinit(allocator);
+    analyzer.* = null;
+}
+
+/// Per frame fade of the spectra while the gate is closed
+const silence_decay = 0.9;
+
+/// Split the channels, then run every live job on the pool, returning once all are done.
+/// In lazy mode the lazy jobs are only fed, and evaluated later by `require`. Lower
+/// qualities skip or hold some jobs, see `Quality`, and most jobs pause during silence.
+pub fn analyze(self: *AudioAnalyzer, stereo: []const f32) void {
+    // No new audio, every result stays as it is
+    if (stereo.len == 0) {
+        return;
     }
 
-    if (flags.key_mono) {
-        self.key_center.classify(&self.chroma_center.chroma);
+    self.frame_count +%= 1;
+    self.frame = .{
+        .sequence = self.frame_count,
+        .timestamp = self.capture_time,
+        .samples = stereo.len / Config.channel_count,
+    };
+
+    const input = blk: {
+        const z = trace.zone("gate");
+        defer z.end();
+        break :blk self.gate.process(stereo);
+    };
+
+    {
+        const z = trace.zone("splix");
+        defer z.end();
+        self.splixer.splix(input orelse stereo);
+    }
+
+    const pool = self.pool orelse return;
+
+    self.frame_done.reset();
+    self.frame_jobs = std.EnumSet(Job).initEmpty();
+    self.evaluated = std.EnumSet(Job).initEmpty();
+
+    var it = self.live.iterator();
+    while (it.next()) |job| {
+        if (!self.quality.skips(job) and !(input == null and job.isSuspendable())) {
+            self.frame_jobs.insert(job);
+        }
     }
 
-    if (flags.pulse_mono) {
-        self.beat_center.execute(center);
+    // Suspended spectra fade out, everything else keeps its last result
+    if (input == null) {
+        inline for (.{ "spectral_analyzer_center", "spectral_analyzer_left", "spectral_analyzer_right", "spectral_analyzer_side" }) |name| {
+            if (@field(self, name)) |*spectrum| spectrum.decay(silence_decay);
+        }
+        inline for (.{ .spectrum_center, .spectrum_left, .spectrum_right, .spectrum_side }) |job| {
+            if (self.live.contains(job)) self.stamps.set(job, self.frame);
+        }
+        for (self.requested.items) |*requested| {
+            if (requested.fft) |*fft| {
+                fft.decay(silence_decay);
+                requested.stamp = self.frame;
+            }
+        }
     }
 
-    if (flags.tempo_mono) {
-        self.tempo_center.execute(center);
+    it = self.frame_jobs.iterator();
+    while (it.next()) |job| {
+        if (!(self.lazy and job.isLazy()) and !self.quality.holds(job, self.frame_count)) {
+            self.evaluated.insert(job);
+        }
+
+        self.nodes.set(job, .{
+            .task = .{ .run = Node.run },
+            .job = job,
+            .analyzer = self,
+            .waiting = std.atomic.Value(u8).init(job.pendingDependencies(self.frame_jobs)),
+        });
+        self.frame_done.start();
     }
 
-    if (flags.frequency_stereo) {
-        self.spectral_analyzer_left.write(left);
-        self.spectral_analyzer_right.write(right);
-        self.spectral_analyzer_left.evaluate();
-        self.spectral_analyzer_right.evaluate();
+    // Dependents are spawned by their last dependency
+    it = self.frame_jobs.iterator();
+    while (it.next()) |job| {
+        if (job.pendingDependencies(self.frame_jobs) == 0) {
+            pool.spawn(&self.nodes.getPtr(job).task);
+        }
+    }
+
+    pool.wait(&self.frame_done);
+}
+
+/// Bring the result of `job` up to date for this frame, evaluating it and its
+/// dependencies on the calling thread if that was deferred. Cheap once evaluated.
+pub fn require(self: *AudioAnalyzer, job: Job) void {
+    if (self.evaluated.contains(job) or !self.frame_jobs.contains(job) or self.quality.holds(job, self.frame_count)) {
+        return;
     }
 
-    if (flags.chromagram_stereo) {
-        self.chroma_left.execute(left);
-        self.chroma_right.execute(right);
+    for (job.dependencies()) |dependency| {
+        self.require(dependency);
     }
 
-    if (flags.breaks_stereo) {
-        self.breaks_left.execute(left);
-        self.breaks_right.execute(right);
+    const start = std.time.nanoTimestamp();
+    self.evaluate(job);
+    self.require_ns += @intCast(@max(std.time.nanoTimestamp() - start, 0));
+
+    self.evaluated.insert(job);
+    self.stamps.set(job, self.frame);
+}
+
+/// Nanoseconds of deferred evaluation by `require` since the last call, which
+/// `analyze` does not include in lazy mode
+pub fn takeRequireTime(self: *AudioAnalyzer) u64 {
+    defer self.require_ns = 0;
+    return self.require_ns;
+}
+
+/// Pass this frame's input to `job`, running it fully if it is not lazy
+fn feed(self: *AudioAnalyzer, job: Job) void {
+    const center = self.splixer.getCenter();
+    const left = self.splixer.getLeft();
+    const right = self.splixer.getRight();
+    const side = self.splixer.getSide();
+
+    switch (job) {
+        .spectrum_center => self.spectral_analyzer_center.?.write(center),
+        .spectrum_left => self.spectral_analyzer_left.?.write(left),
+        .spectrum_right => self.spectral_analyzer_right.?.write(right),
+        .spectrum_side => self.spectral_analyzer_side.?.write(side),
+        .chroma_center => self.chroma_center.?.write(center),
+        .chroma_left => self.chroma_left.?.write(left),
+        .chroma_right => self.chroma_right.?.write(right),
+        .key_center, .key_left, .key_right => {},
+        // Never suspended, so they already saw the pre-roll the gate replays on opening
+        .breaks_center => self.breaks_center.execute(self.newest(center)),
+        .breaks_left => self.breaks_left.execute(self.newest(left)),
+        .breaks_right => self.breaks_right.execute(self.newest(right)),
+        .beat_center => self.beat_center.?.execute(center),
+        .tempo_center => self.tempo_center.?.execute(self.newest(center), self.frame),
+        .mood_center => self.mood_center.?.write(center),
+        .requested_spectra => for (self.requested.items) |*requested| {
+            const fft = if (requested.fft) |*fft| fft else continue;
+            const samples = switch (requested.request.channel) {
+                .center => center,
+                .left => left,
+                .right => right,
+                .side => side,
+            };
+            fft.write(samples);
+            requested.pending += samples.len;
+        },
     }
+}
 
-    if (flags.key_stereo) {
-        self.key_left.classify(&self.chroma_left.chroma);
-        self.key_right.classify(&self.chroma_right.chroma);
+/// The part of split `samples` that came with this frame's input, without any pre-roll
+fn newest(self: *const AudioAnalyzer, samples: []const f32) []const f32 {
+    return samples[samples.len - @min(samples.len, self.frame.samples) ..];
+}
+
+/// Compute the result of a lazy job from the input fed so far
+fn evaluate(self: *AudioAnalyzer, job: Job) void {
+    switch (job) {
+        .spectrum_center => self.spectral_analyzer_center.?.evaluate(),
+        .spectrum_left => self.spectral_analyzer_left.?.evaluate(),
+        .spectrum_right => self.spectral_analyzer_right.?.evaluate(),
+        .spectrum_side => self.spectral_analyzer_side.?.evaluate(),
+        .chroma_center => self.evaluateChroma(&self.chroma_center.?),
+        .chroma_left => self.evaluateChroma(&self.chroma_left.?),
+        .chroma_right => self.evaluateChroma(&self.chroma_right.?),
+        .key_center => self.key_center.classify(&self.chroma_center.?.chroma),
+        .key_left => self.key_left.classify(&self.chroma_left.?.chroma),
+        .key_right => self.key_right.classify(&self.chroma_right.?.chroma),
+        .mood_center => self.mood_center.?.evaluate(),
+        .requested_spectra => for (self.requested.items) |*requested| {
+            const fft = if (requested.fft) |*fft| fft else continue;
+            if (requested.pending >= requested.request.hop) {
+                fft.evaluate();
+                requested.pending = 0;
+                requested.stamp = self.frame;
+            }
+        },
+        .breaks_center, .breaks_left, .breaks_right => {},
+        .beat_center, .tempo_center => {},
     }
+}
+
+fn evaluateChroma(self: *AudioAnalyzer, chroma: *Chroma) void {
+    chroma.max_partials = self.quality.maxPartials();
+    chroma.max_octaves = self.quality.maxOctaves();
+    chroma.evaluate();
+}
 
-    if (flags.mood_mono) {
-        self.mood_center.analyze(center);
+test "steady-state analysis does not allocate" {
+    const CountingAllocator = @import("../CountingAllocator.zig");
+    const signal = @import("generator/signal.zig");
+
+    var counting = CountingAllocator.init(std.testing.allocator);
+    const allocator = counting.allocator();
+
+    var analyzer = try AudioAnalyzer.init(allocator);
+    defer analyzer.deinit(allocator);
+    try analyzer.configure(Flags.all(), allocator);
+
+    var input: [1024 * Config.channel_count]f32 = undefined;
+    var generator = signal.Generator.init(.{ .chord = .{} }, Config.sample_rate);
+
+    const before = counting.total.load(.monotonic);
+    for (0..64) |_| {
+        generator.render(&input);
+        analyzer.analyze(&input);
     }
+
+    try std.testing.expectEqual(before, counting.total.load(.monotonic));
 }
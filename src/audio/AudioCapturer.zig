@@ -1,39 +1,116 @@
 const std = @import("std");
 const builtin = @import("builtin");
+const build_options = @import("build_options");
 
 /// The audio format is ieee 32-bit float.
 const AudioCapturer = @This();
 
 const Config = @import("Config.zig");
 
-pub const Impl = switch (builtin.os.tag) {
+pub const NativeImpl = switch (builtin.os.tag) {
     .linux => @import("linux/capture.zig").LinuxImpl,
     .windows => @import("windows/capture.zig").WindowsImpl,
     .macos => @import("mac/capture.zig").MacOSImpl,
     else => @compileError("Unsupported operating system " ++ @tagName(builtin.os.tag)),
 };
 
+pub const GeneratorImpl = @import("generator/capture.zig").GeneratorImpl;
+
+pub const PipeWireImpl = if (builtin.os.tag == .linux and build_options.pipewire)
+    @import("pipewire/capture.zig").PipeWireImpl
+else
+    UnavailableImpl;
+
+/// Stands in for backends that are not part of this build
+const UnavailableImpl = struct {
+    pub fn init(config: Config, allocator: std.mem.Allocator) !UnavailableImpl {
+        _ = config;
+        _ = allocator;
+        return error.backend_unavailable;
+    }
+
+    pub fn deinit(self: *UnavailableImpl, allocator: std.mem.Allocator) void {
+        _ = self;
+        _ = allocator;
+    }
+
+    pub fn start(self: *UnavailableImpl) !void {
+        _ = self;
+    }
+
+    pub fn stop(self: *UnavailableImpl) !void {
+        _ = self;
+    }
+
+    pub fn sample(self: *UnavailableImpl) []const f32 {
+        _ = self;
+        return &.{};
+    }
+};
+
+pub const Impl = union(Config.Backend) {
+    native: NativeImpl,
+    generator: GeneratorImpl,
+    pipewire: PipeWireImpl,
+};
+
 impl: Impl,
 
 pub fn init(config: Config, allocator: std.mem.Allocator) !AudioCapturer {
     return AudioCapturer{
-        .impl = try Impl.init(config, allocator),
+        .impl = switch (config.backend) {
+            .native => .{ .native = try NativeImpl.init(config, allocator) },
+            .generator => .{ .generator = try GeneratorImpl.init(config, allocator) },
+            .pipewire => .{ .pipewire = try PipeWireImpl.init(config, allocator) },
+        },
     };
 }
 
 pub fn deinit(self: *AudioCapturer, allocator: std.mem.Allocator) void {
-    self.impl.deinit(allocator);
+    switch (self.impl) {
+        inline else => |*impl| impl.deinit(allocator),
+    }
     self.* = undefined;
 }
 
 pub fn start(self: *AudioCapturer) !void {
-    return self.impl.start();
+    switch (self.impl) {
+        inline else => |*impl| return impl.start(),
+    }
 }
 
 pub fn stop(self: *AudioCapturer) !void {
-    return self.impl.stop();
+    switch (self.impl) {
+        inline else => |*impl| return impl.stop(),
+    }
 }
 
 pub fn sample(self: *AudioCapturer) []const f32 {
-    return self.impl.sample();
+    switch (self.impl) {
+        inline else => |*impl| return impl.sample(),
+    }
+}
+
+/// Measured capture latency in microseconds, if the backend reports it
+pub fn latency(self: *const AudioCapturer) ?u64 {
+    switch (self.impl) {
+        inline else => |*impl| {
+            if (@hasDecl(@TypeOf(impl.*), "latency")) {
+                return impl.latency();
+            }
+            return null;
+        },
+    }
+}
+
+/// Rate of the captured stream, which may differ from `Config.sample_rate`
+pub fn sampleRate(self: *const AudioCapturer) u32 {
+    switch (self.impl) {
+        inline else => |*impl| {
+            if (@hasDecl(@TypeOf(impl.*), "sampleRate")) {
+                return impl.sampleRate();
+            }
+            return Config.sample_rate;
+        },
+    }
 }
@@ -1,44 +1,101 @@
 const std = @import("std");
 const AudioSplixer = @This();
 
+const vector_len = std.simd.suggestVectorLength(f32) orelse 4;
+const Vec = @Vector(vector_len, f32);
+
+pub const Channel = enum {
+    /// (L + R) / 2, also the mid signal
+    center,
+    left,
+    right,
+
+    /// (L - R) / 2
+    side,
+};
+
 left: []f32,
 right: []f32,
 center: []f32,
+side: []f32,
 capacity: usize,
 
+/// Channels written by `splix`, the others are left empty
+channels: std.EnumSet(Channel),
+
 pub fn init(capacity: usize, allocator: std.mem.Allocator) !AudioSplixer {
-    const buf = try allocator.alloc(f32, capacity * 3);
+    const buf = try allocator.alignedAlloc(f32, 64, capacity * 4);
 
     return @This(){
         .left = buf[capacity * 2 .. capacity * 2],
         .right = buf[capacity..capacity],
         .center = buf[0..0],
+        .side = buf[capacity * 3 .. capacity * 3],
         .capacity = capacity,
+        .channels = std.EnumSet(Channel).initMany(&.{ .center, .left, .right }),
     };
 }
 
 pub fn deinit(self: *AudioSplixer, allocator: std.mem.Allocator) void {
-    allocator.free(self.center.ptr[0 .. self.capacity * 3]);
+    const buf: []align(64) f32 = @alignCast(self.center.ptr[0 .. self.capacity * 4]);
+    allocator.free(buf);
     self.* = undefined;
 }
 
 pub fn splix(self: *AudioSplixer, stereo: []const f32) void {
     std.debug.assert(stereo.len <= self.capacity << 1);
 
-    self.left.len = stereo.len;
-    self.right.len = stereo.len;
-    self.center.len = stereo.len;
+    const frames = stereo.len >> 1;
+    const want_center = self.channels.contains(.center);
+    const want_left = self.channels.contains(.left);
+    const want_right = self.channels.contains(.right);
+    const want_side = self.channels.contains(.side);
 
-    for (0..stereo.len >> 1) |i| {
+    self.left.len = if (want_left) frames else 0;
+    self.right.len = if (want_right) frames else 0;
+    self.center.len = if (want_center) frames else 0;
+    self.side.len = if (want_side) frames else 0;
+
+    const half: Vec = @splat(0.5);
+    var i: usize = 0;
+
+    while (i + vector_len <= frames) : (i += vector_len) {
+        const a: Vec = stereo[i << 1 ..][0..vector_len].*;
+        const b: Vec = stereo[(i << 1) + vector_len ..][0..vector_len].*;
+        const l = @shuffle(f32, a, b, deinterleave_mask[0]);
+        const r = @shuffle(f32, a, b, deinterleave_mask[1]);
+
+        if (want_left) self.left[i..][0..vector_len].* = l;
+        if (want_right) self.right[i..][0..vector_len].* = r;
+        if (want_center) self.center[i..][0..vector_len].* = (l + r) * half;
+        if (want_side) self.side[i..][0..vector_len].* = (l - r) * half;
+    }
+
+    while (i < frames) : (i += 1) {
         const l = stereo[(i << 1) + 0];
         const r = stereo[(i << 1) + 1];
 
-        self.left[i] = l;
-        self.right[i] = r;
-        self.center[i] = (l + r) / 2;
+        if (want_left) self.left[i] = l;
+        if (want_right) self.right[i] = r;
+        if (want_center) self.center[i] = (l + r) / 2;
+        if (want_side) self.side[i] = (l - r) / 2;
     }
 }
 
+/// Shuffle masks picking the even and odd lanes of two concatenated vectors
+const deinterleave_mask = blk: {
+    var masks: [2][vector_len]i32 = undefined;
+
+    for (0..2) |c| {
+        for (0..vector_len) |k| {
+            const j = 2 * k + c;
+            masks[c][k] = if (j < vector_len) j else ~@as(i32, j - vector_len);
+        }
+    }
+
+    break :blk masks;
+};
+
 pub inline fn getLeft(self: *const AudioSplixer) []const f32 {
     return self.left;
 }
@@ -50,3 +107,7 @@ pub inline fn getRight(self: *const AudioSplixer) []const f32 {
 pub inline fn getCenter(self: *const AudioSplixer) []const f32 {
     return self.center;
 }
+
+pub inline fn getSide(self: *const AudioSplixer) []const f32 {
+    return self.side;
+}
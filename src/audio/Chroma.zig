@@ -28,6 +28,10 @@ num_bins: usize = 4,
 // Number of partials to consider
 num_partials: usize = 3,
 
+// Caps on octaves and partials, lowered by the quality governor under load
+max_octaves: usize = std.math.maxInt(usize),
+max_partials: usize = std.math.maxInt(usize),
+
 // Pitches of chromatic scale starting from C3
 pitches: [12]f32,
 samplerate: u32,
@@ -73,9 +77,19 @@ fn binIdFromFrequency(self: *Chroma, freq: f32, size: usize) usize {
 }
 
 pub fn execute(self: *Chroma, samples: []const f32) void {
+    self.write(samples);
+    self.evaluate();
+}
 
-    // Apply FFT
+/// Feed samples without computing the chromagram
+pub fn write(self: *Chroma, samples: []const f32) void {
     self.fft.write(samples);
+}
+
+/// Compute the chromagram from the samples written so far
+pub fn evaluate(self: *Chroma) void {
+
+    // Apply FFT
     self.fft.evaluate();
     const spect = self.fft.read();
 
@@ -87,12 +101,12 @@ pub fn execute(self: *Chroma, samples: []const f32) void {
     // Compute chromagram
     @memset(&self.chroma, 0.0);
     for (&self.chroma, 0..) |*c, n| {
-        for (0..self.num_octaves) |o| {
+        for (0..@min(self.num_octaves, self.max_octaves)) |o| {
 
             // Fundamental frequency for pitch n in octave o
             const fund = self.pitches[n] * std.math.pow(f32, 2.0, @floatFromInt(o));
 
-            for (1..self.num_partials + 1) |h| {
+            for (1..@min(self.num_partials, self.max_partials) + 1) |h| {
                 const hf: f32 = @floatFromInt(h);
 
                 // Partial frequency
@@ -1,10 +1,60 @@
+const std = @import("std");
+const build_options = @import("build_options");
 const Config = @This();
 
 pub const channel_count = 2;
 pub const sample_rate = 44100; // Hz
 pub const window_time: u32 = 20; // ms
 
+pub const Backend = enum {
+    /// The platform's audio server, capturing the process `process_id`
+    native,
+    /// Synthetic test signal described by `process_id`
+    generator,
+    /// Native PipeWire capture of the process `process_id`, Linux builds with `-Dpipewire` only
+    pipewire,
+};
+
+/// Prefix of process ids that select the test signal generator, e.g. `gen:click:120`
+pub const generator_prefix = "gen:";
+
+/// Prefixes of process ids that select a capture backend at run time, e.g. `pw:1234`
+pub const pipewire_prefix = "pw:";
+pub const native_prefix = "native:";
+
+/// Backend for process ids without a prefix
+pub const default_backend: Backend = if (build_options.pipewire) .pipewire else .native;
+
 process_id: []const u8 = undefined,
+backend: Backend = default_backend,
+
+/// Request small capture fragments, trading CPU time for less audio-to-visual delay.
+/// Only the PulseAudio backend on Linux honors it.
+low_latency: bool = false,
+
+/// Select backend from a user supplied process id
+pub fn fromProcessId(process_id: []const u8, low_latency: bool) Config {
+    const prefixes = .{
+        .{ generator_prefix, Backend.generator },
+        .{ pipewire_prefix, Backend.pipewire },
+        .{ native_prefix, Backend.native },
+    };
+
+    inline for (prefixes) |prefix| {
+        if (std.mem.startsWith(u8, process_id, prefix[0])) {
+            return .{
+                .process_id = process_id[prefix[0].len..],
+                .backend = prefix[1],
+                .low_latency = low_latency,
+            };
+        }
+    }
+
+    return .{
+        .process_id = process_id,
+        .low_latency = low_latency,
+    };
+}
 
 pub fn bitDepth() comptime_int {
     return @bitSizeOf(f32);
@@ -0,0 +1,240 @@
+//!
+//! Triangular filters spaced on a log, mel or Bark scale, reducing a magnitude
+//! spectrum to a few bands. Each filter covers one contiguous run of bins, so
+//! the matrix is stored sparse and applied as one short dot product per band.
+//!
+
+const std = @import("std");
+const Filterbank = @This();
+
+const Config = @import("Config.zig");
+
+const vector_len = std.simd.suggestVectorLength(f32) orelse 4;
+const Vec = @Vector(vector_len, f32);
+
+/// Lower edge of the first band in Hz, the upper edge of the last is Nyquist
+pub const min_frequency = 20.0;
+
+pub const max_bands = 1024;
+
+pub const Scale = enum {
+    /// Equal octave fractions per band
+    log,
+    mel,
+    bark,
+
+    fn fromHz(self: Scale, hz: f32) f32 {
+        return switch (self) {
+            .log => @log2(hz),
+            .mel => 2595.0 * @log10(1.0 + hz / 700.0),
+            // Traunmüller's approximation
+            .bark => 26.81 * hz / (1960.0 + hz) - 0.53,
+        };
+    }
+
+    fn toHz(self: Scale, value: f32) f32 {
+        return switch (self) {
+            .log => @exp2(value),
+            .mel => 700.0 * (std.math.pow(f32, 10.0, value / 2595.0) - 1.0),
+            .bark => 1960.0 * (value + 0.53) / (26.28 - value),
+        };
+    }
+};
+
+/// First bin of each band
+starts: []u32,
+
+/// Where each band's weights begin in `weights`, with one more entry for the end
+offsets: []u32,
+
+/// Weights of all bands, each band's summing to one
+weights: []f32,
+
+/// Bands for a spectrum of `bins` magnitudes from 0 Hz to Nyquist
+pub fn init(scale: Scale, bands: usize, bins: usize, allocator: std.mem.Allocator) !Filterbank {
+    std.debug.assert(bands > 0 and bands <= max_bands and bins > 0);
+
+    const starts = try allocator.alloc(u32, bands);
+    errdefer allocator.free(starts);
+
+    const offsets = try allocator.alloc(u32, bands + 1);
+    errdefer allocator.free(offsets);
+
+    const edges = Edges.init(scale, bands, bins);
+
+    // Size every run first, so all weights fit one allocation
+    var total: u32 = 0;
+    for (starts, offsets[0..bands], 0..) |*start, *offset, band| {
+        const run = edges.run(band);
+        start.* = run.start;
+        offset.* = total;
+        total += run.len;
+    }
+    offsets[bands] = total;
+
+    const weights = try allocator.alloc(f32, total);
+    errdefer allocator.free(weights);
+
+    for (0..bands) |band| {
+        const run = weights[offsets[band]..offsets[band + 1]];
+        if (run.len == 1) {
+            run[0] = 1.0;
+            continue;
+        }
+
+        const lower, const center, const upper = edges.triangle(band);
+        var sum: f32 = 0.0;
+        for (run, starts[band]..) |*weight, bin| {
+            const hz = edges.binHz(bin);
+            weight.* = @max(0.0, if (hz <= center) (hz - lower) / (center - lower) else (upper - hz) / (upper - center));
+            sum += weight.*;
+        }
+
+        for (run) |*weight| {
+            weight.* = if (sum > 0.0) weight.* / sum else 1.0 / @as(f32, @floatFromInt(run.len));
+        }
+    }
+
+    return Filterbank{
+        .starts = starts,
+        .offsets = offsets,
+        .weights = weights,
+    };
+}
+
+pub fn deinit(self: *Filterbank, allocator: std.mem.Allocator) void {
+    allocator.free(self.starts);
+    allocator.free(self.offsets);
+    allocator.free(self.weights);
+    self.* = undefined;
+}
+
+pub fn bandCount(self: *const Filterbank) usize {
+    return self.starts.len;
+}
+
+/// Weighted means of `spectrum` per band into `out`, which holds `bandCount` values
+pub fn apply(self: *const Filterbank, spectrum: []const f32, out: []f32) void {
+    for (out, self.starts, 0..) |*y, start, band| {
+        const weights = self.weights[self.offsets[band]..self.offsets[band + 1]];
+        y.* = dot(weights, spectrum[start..][0..weights.len]);
+    }
+}
+
+/// Band edges evenly spaced on the scale
+const Edges = struct {
+    scale: Scale,
+    low: f32,
+    step: f32,
+    bins: usize,
+    bin_width: f32,
+
+    const Run = struct { start: u32, len: u32 };
+
+    fn init(scale: Scale, bands: usize, bins: usize) Edges {
+        const nyquist = @as(f32, Config.sample_rate) / 2.0;
+        const low = scale.fromHz(min_frequency);
+
+        return .{
+            .scale = scale,
+            .low = low,
+            .step = (scale.fromHz(nyquist) - low) / @as(f32, @floatFromInt(bands + 1)),
+            .bins = bins,
+            .bin_width = nyquist / @as(f32, @floatFromInt(bins)),
+        };
+    }
+
+    fn edge(self: Edges, i: usize) f32 {
+        return self.scale.toHz(self.low + self.step * @as(f32, @floatFromInt(i)));
+    }
+
+    /// Lower edge, peak and upper edge of `band` in Hz
+    fn triangle(self: Edges, band: usize) [3]f32 {
+        return .{ self.edge(band), self.edge(band + 1), self.edge(band + 2) };
+    }
+
+    fn binHz(self: Edges, bin: usize) f32 {
+        return @as(f32, @floatFromInt(bin)) * self.bin_width;
+    }
+
+    fn bin(self: Edges, hz: f32) usize {
+        return @min(self.bins - 1, @as(usize, @intFromFloat(@max(0.0, hz / self.bin_width))));
+    }
+
+    /// Bins strictly inside the triangle, or the bin nearest the peak when the band is
+    /// narrower than one bin
+    fn run(self: Edges, band: usize) Run {
+        const lower, const center, const upper = self.triangle(band);
+
+        const first = self.bin(lower) + 1;
+        const last = self.bin(upper);
+        const end = if (self.binHz(last) < upper) last + 1 else last;
+
+        if (first >= end) {
+            return .{ .start = @intCast(self.bin(center + self.bin_width / 2.0)), .len = 1 };
+        }
+        return .{ .start = @intCast(first), .len = @intCast(end - first) };
+    }
+};
+
+fn dot(a: []const f32, b: []const f32) f32 {
+    var acc: Vec = @splat(0.0);
+    var i: usize = 0;
+
+    while (i + vector_len <= a.len) : (i += vector_len) {
+        const x: Vec = a[i..][0..vector_len].*;
+        const y: Vec = b[i..][0..vector_len].*;
+        acc += x * y;
+    }
+
+    var sum = @reduce(.Add, acc);
+    while (i < a.len) : (i += 1) {
+        sum += a[i] * b[i];
+    }
+
+    return sum;
+}
+
+test "band weights sum to one" {
+    for (std.enums.values(Scale)) |scale| {
+        for ([_]usize{ 1, 8, 64, 512 }) |bands| {
+            var filterbank = try Filterbank.init(scale, bands, 2048, std.testing.allocator);
+            defer filterbank.deinit(std.testing.allocator);
+
+            for (0..bands) |band| {
+                var sum: f32 = 0.0;
+                for (filterbank.weights[filterbank.offsets[band]..filterbank.offsets[band + 1]]) |weight| {
+                    try std.testing.expect(weight >= 0.0);
+                    sum += weight;
+                }
+                try std.testing.expectApproxEqAbs(@as(f32, 1.0), sum, 1e-4);
+            }
+        }
+    }
+}
+
+test "band runs stay within the spectrum" {
+    for (std.enums.values(Scale)) |scale| {
+        for ([_]usize{ 64, 1024 }) |bins| {
+            var filterbank = try Filterbank.init(scale, max_bands, bins, std.testing.allocator);
+            defer filterbank.deinit(std.testing.allocator);
+
+            try std.testing.expectEqual(0, filterbank.offsets[0]);
+            try std.testing.expectEqual(filterbank.weights.len, filterbank.offsets[max_bands]);
+
+            for (filterbank.starts, 0..) |start, band| {
+                const len = filterbank.offsets[band + 1] - filterbank.offsets[band];
+                try std.testing.expect(len >= 1);
+                try std.testing.expect(start + len <= bins);
+            }
+        }
+    }
+}
+
+test "scales invert" {
+    for (std.enums.values(Scale)) |scale| {
+        for ([_]f32{ min_frequency, 100.0, 1000.0, 4000.0, 16000.0, @as(f32, Config.sample_rate) / 2.0 }) |hz| {
+            try std.testing.expectApproxEqRel(hz, scale.toHz(scale.fromHz(hz)), 1e-4);
+        }
+    }
+}
@@ -0,0 +1,124 @@
+//!
+//! Detects sustained silence with a cheap RMS check so expensive analyses can
+//! be suspended. While closed it keeps a short pre-roll of the newest input,
+//! which is replayed when sound returns so windowed analyses resume at once.
+//!
+
+const std = @import("std");
+const Gate = @This();
+
+const Config = @import("Config.zig");
+
+const log = std.log.scoped(.gate);
+
+const vector_len = std.simd.suggestVectorLength(f32) orelse 4;
+const Vec = @Vector(vector_len, f32);
+
+/// Covers the longest analysis window
+pub const pre_roll_frames = 4096;
+
+/// RMS below which input counts as silent, -60 dBFS
+threshold: f32 = 0.001,
+
+/// Silent frames before the gate closes
+hold: usize = Config.sample_rate,
+
+enabled: bool = true,
+closed: bool = false,
+
+/// Consecutive silent frames while open
+silent: usize = 0,
+
+/// Ring of the newest interleaved input while closed
+pre_roll: []f32,
+cursor: usize = 0,
+
+/// Pre-roll followed by the input that opened the gate
+out: []f32,
+
+/// `max_len` is the longest interleaved input passed to `process`
+pub fn init(max_len: usize, allocator: std.mem.Allocator) !Gate {
+    const pre_roll = try allocator.alloc(f32, pre_roll_frames * Config.channel_count);
+    errdefer allocator.free(pre_roll);
+
+    const out = try allocator.alloc(f32, pre_roll.len + max_len);
+    errdefer allocator.free(out);
+
+    return Gate{
+        .pre_roll = pre_roll,
+        .out = out,
+    };
+}
+
+pub fn deinit(self: *Gate, allocator: std.mem.Allocator) void {
+    allocator.free(self.pre_roll);
+    allocator.free(self.out);
+    self.* = undefined;
+}
+
+/// Returns the input to analyze, or null while the gate is closed. The frame
+/// that opens the gate is returned with the pre-roll in front of it.
+pub fn process(self: *Gate, stereo: []const f32) ?[]const f32 {
+    const loud = !self.enabled or rootMeanSquare(stereo) >= self.threshold;
+
+    if (!self.closed) {
+        self.silent = if (loud) 0 else self.silent + stereo.len / Config.channel_count;
+
+        if (self.silent >= self.hold) {
+            log.debug("closed after {d} silent frames", .{self.silent});
+            self.closed = true;
+            self.cursor = 0;
+            @memset(self.pre_roll, 0);
+        }
+        return stereo;
+    }
+
+    if (!loud) {
+        self.remember(stereo);
+        return null;
+    }
+
+    log.debug("opened", .{});
+    self.closed = false;
+    self.silent = 0;
+
+    const n = self.pre_roll.len;
+    @memcpy(self.out[0 .. n - self.cursor], self.pre_roll[self.cursor..]);
+    @memcpy(self.out[n - self.cursor .. n], self.pre_roll[0..self.cursor]);
+
+    const input = stereo[stereo.len - @min(stereo.len, self.out.len - n) ..];
+    @memcpy(self.out[n..][0..input.len], input);
+
+    return self.out[0 .. n + input.len];
+}
+
+fn remember(self: *Gate, stereo: []const f32) void {
+    const input = stereo[stereo.len - @min(stereo.len, self.pre_roll.len) ..];
+    const first = @min(input.len, self.pre_roll.len - self.cursor);
+
+    @memcpy(self.pre_roll[self.cursor..][0..first], input[0..first]);
+    @memcpy(self.pre_roll[0 .. input.len - first], input[first..]);
+
+    self.cursor = (self.cursor + input.len) % self.pre_roll.len;
+}
+
+fn rootMeanSquare(samples: []const f32) f32 {
+    if (samples.len == 0) {
+        return 0.0;
+    }
+
+    var acc: Vec = @splat(0.0);
+    var i: usize = 0;
+
+    while (i + vector_len <= samples.len) : (i += vector_len) {
+        const x: Vec = samples[i..][0..vector_len].*;
+        acc += x * x;
+    }
+
+    var sum = @reduce(.Add, acc);
+    while (i < samples.len) : (i += 1) {
+        sum += samples[i] * samples[i];
+    }
+
+    return @sqrt(sum / @as(f32, @floatFromInt(samples.len)));
+}
@@ -0,0 +1,67 @@
+//!
+//! Picks the analysis quality from the time `AudioAnalyzer.analyze` takes per
+//! frame, stepping down when over budget and back up when there is headroom
+//!
+
+const std = @import("std");
+const Governor = @This();
+
+const Quality = @import("AudioAnalyzer.zig").Quality;
+
+const log = std.log.scoped(.governor);
+
+/// Weight of the newest frame in the smoothed cost
+const smoothing = 0.1;
+
+/// Frames over budget before stepping down
+const lower_after = 10;
+
+/// Frames with headroom before stepping up, longer so quality does not oscillate
+const raise_after = 120;
+
+/// Fraction of the budget the cost has to stay under to step up
+const headroom = 0.5;
+
+/// Analysis time per frame to stay within, in milliseconds
+budget_ms: f32 = 4.0,
+
+quality: Quality = .full,
+
+/// Smoothed analysis time per frame, in milliseconds
+cost_ms: f32 = 0.0,
+
+over: u32 = 0,
+under: u32 = 0,
+
+/// Account one frame's analysis time, returns the quality to use from now on
+pub fn update(self: *Governor, elapsed_ns: u64) Quality {
+    const ms = @as(f32, @floatFromInt(elapsed_ns)) / std.time.ns_per_ms;
+    self.cost_ms += smoothing * (ms - self.cost_ms);
+
+    if (self.cost_ms > self.budget_ms) {
+        self.over += 1;
+        self.under = 0;
+    } else if (self.cost_ms < headroom * self.budget_ms) {
+        self.under += 1;
+        self.over = 0;
+    } else {
+        self.over = 0;
+        self.under = 0;
+    }
+
+    const next = if (self.over >= lower_after)
+        self.quality.lower()
+    else if (self.under >= raise_after)
+        self.quality.higher()
+    else
+        null;
+
+    if (next) |quality| {
+        log.info("{d:.2} ms per frame against {d:.2} ms, quality {s}", .{ self.cost_ms, self.budget_ms, @tagName(quality) });
+        self.quality = quality;
+        self.over = 0;
+        self.under = 0;
+    }
+
+    return self.quality;
+}
@@ -18,7 +18,8 @@ const Result = struct {
     confidence: f32,
 };
 
-result: Result = undefined,
+/// C major with no confidence until the first `classify`
+result: Result = .{ .pitch_class = 0, .key_type = 0, .confidence = 0.0 },
 
 pub fn classify(self: *Key, chromagram: []const f32) void {
     self.result = Result{
@@ -0,0 +1,188 @@
+//!
+//! Mixes any number of capture sources into one stream, so adding
+//! sources does not add analysis passes
+//!
+
+const std = @import("std");
+const Mixer = @This();
+
+const AudioCapturer = @import("AudioCapturer.zig");
+const Config = @import("Config.zig");
+const trace = @import("../trace.zig");
+const Resampler = @import("resample.zig").Resampler;
+
+const log = std.log.scoped(.mixer);
+
+const vector_len = std.simd.suggestVectorLength(f32) orelse 4;
+const Vec = @Vector(vector_len, f32);
+
+pub const Source = struct {
+    capturer: *AudioCapturer,
+
+    /// Linear gain applied before mixing
+    gain: f32 = 1.0,
+
+    /// Process id the source was connected with, for display
+    name: [64:0]u8,
+
+    /// Converts to `Config.sample_rate` if the source runs at a different rate
+    resampler: ?Resampler = null,
+
+    /// Samples delivered but not mixed yet, oldest first
+    fifo: []f32 = &.{},
+    queued: usize = 0,
+
+    fn sample(self: *Source) []const f32 {
+        const z = trace.zone("source sample");
+        defer z.end();
+
+        const raw = self.capturer.sample();
+        return if (self.resampler) |*resampler| resampler.process(raw) else raw;
+    }
+
+    /// Append the newly delivered samples, dropping the oldest when full
+    fn enqueue(self: *Source) void {
+        const sample = self.sample();
+        const new = sample[sample.len - @min(sample.len, self.fifo.len) ..];
+
+        const overflow = (self.queued + new.len) -| self.fifo.len;
+        if (overflow > 0) {
+            self.dequeue(overflow);
+        }
+
+        @memcpy(self.fifo[self.queued..][0..new.len], new);
+        self.queued += new.len;
+    }
+
+    fn dequeue(self: *Source, len: usize) void {
+        const n = @min(len, self.queued);
+        std.mem.copyForwards(f32, self.fifo, self.fifo[n..self.queued]);
+        self.queued -= n;
+    }
+};
+
+/// Connected sources, not owned by the mixer
+sources: std.ArrayList(Source),
+
+/// Mixed output
+buffer: []f32,
+
+pub fn init(allocator: std.mem.Allocator) !Mixer {
+    return Mixer{
+        .sources = std.ArrayList(Source).init(allocator),
+        .buffer = try allocator.alloc(f32, Config.windowSize() / @sizeOf(f32)),
+    };
+}
+
+pub fn deinit(self: *Mixer, allocator: std.mem.Allocator) void {
+    for (self.sources.items) |*source| {
+        if (source.resampler) |*resampler| resampler.deinit(allocator);
+        allocator.free(source.fifo);
+    }
+    self.sources.deinit();
+    allocator.free(self.buffer);
+    self.* = undefined;
+}
+
+pub fn add(self: *Mixer, capturer: *AudioCapturer, name: []const u8, allocator: std.mem.Allocator) !void {
+    var source = Source{ .capturer = capturer, .name = undefined };
+
+    const len = @min(name.len, source.name.len);
+    @memcpy(source.name[0..len], name[0..len]);
+    source.name[len] = 0;
+
+    const rate = capturer.sampleRate();
+    if (rate != Config.sample_rate) {
+        log.info("resampling {s} from {d} Hz", .{ name, rate });
+
+        // Capture buffers hold the same duration at any rate
+        const max_frames = (self.buffer.len / Config.channel_count) * (std.math.divCeil(u32, rate, Config.sample_rate) catch unreachable);
+        source.resampler = try Resampler.init(rate, Config.sample_rate, Config.channel_count, max_frames, allocator);
+    }
+    errdefer if (source.resampler) |*resampler| resampler.deinit(allocator);
+
+    source.fifo = try allocator.alloc(f32, self.buffer.len);
+    errdefer allocator.free(source.fifo);
+
+    try self.sources.append(source);
+}
+
+/// Remove a source, returning its capturer to the caller
+pub fn remove(self: *Mixer, index: usize, allocator: std.mem.Allocator) *AudioCapturer {
+    var source = self.sources.orderedRemove(index);
+    if (source.resampler) |*resampler| resampler.deinit(allocator);
+    allocator.free(source.fifo);
+
+    // Realign the remaining sources from their next delivery
+    for (self.sources.items) |*remaining| {
+        remaining.queued = 0;
+    }
+    return source.capturer;
+}
+
+/// Largest capture latency of the sources in microseconds, zero where unknown
+pub fn latency(self: *const Mixer) u64 {
+    var max: u64 = 0;
+    for (self.sources.items) |source| {
+        max = @max(max, source.capturer.latency() orelse 0);
+    }
+    return max;
+}
+
+/// Sample every source and return their weighted sum. Sources deliver different
+/// amounts per call, so each is queued and only what all of them have is mixed.
+pub fn mix(self: *Mixer) []const f32 {
+    // A single unity-gain source needs no copy
+    if (self.sources.items.len == 1 and self.sources.items[0].gain == 1.0) {
+        const sample = self.sources.items[0].sample();
+        return sample[sample.len - @min(sample.len, self.buffer.len) ..];
+    }
+
+    if (self.sources.items.len == 0) {
+        return self.buffer[0..0];
+    }
+
+    var len: usize = std.math.maxInt(usize);
+    var most: usize = 0;
+
+    for (self.sources.items) |*source| {
+        source.enqueue();
+        len = @min(len, source.queued);
+        most = @max(most, source.queued);
+    }
+
+    // A stalled source would hold back the others, once they are half a buffer
+    // ahead it is padded with silence instead
+    if (most > self.buffer.len / 2) {
+        len = most;
+    }
+
+    const out = self.buffer[0..@min(len, self.buffer.len)];
+    @memset(out, 0);
+
+    for (self.sources.items) |*source| {
+        const n = @min(out.len, source.queued);
+        accumulate(out[0..n], source.fifo[0..n], source.gain);
+        source.dequeue(n);
+    }
+
+    return out;
+}
+
+/// dst += src * gain
+fn accumulate(dst: []f32, src: []const f32, gain: f32) void {
+    std.debug.assert(dst.len == src.len);
+
+    const g: Vec = @splat(gain);
+    var i: usize = 0;
+
+    while (i + vector_len <= dst.len) : (i += vector_len) {
+        const d: Vec = dst[i..][0..vector_len].*;
+        const s: Vec = src[i..][0..vector_len].*;
+        dst[i..][0..vector_len].* = d + s * g;
+    }
+
+    while (i < dst.len) : (i += 1) {
+        dst[i] += src[i] * gain;
+    }
+}
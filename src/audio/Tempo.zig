@@ -1,12 +1,19 @@
 const std = @import("std");
 const FFT = @import("fft.zig");
 const Config = @import("Config.zig");
+const trace = @import("../trace.zig");
+const ThreadPool = @import("../ThreadPool.zig");
+const Resampler = @import("resample.zig").Resampler;
+const Stamp = @import("AudioAnalyzer.zig").Stamp;
 const Self = @This();
 
 const c32 = std.math.Complex(f32);
 
-const N: usize = 131072 * 2;
-const sample_rate = Config.sample_rate;
+/// The highest band ends at 3200 Hz, so a quarter of the capture rate is plenty
+const decimation = 4;
+
+const N: usize = 65536;
+const sample_rate = Config.sample_rate / decimation;
 const band_limits = [_]usize{ 0, 200, 400, 800, 1600, 3200 };
 const n_bands: usize = band_limits.len;
 const win_len: f32 = 0.4;
@@ -30,48 +37,60 @@ fn bpm_to_idx(bpm: f32) usize {
 
 const Context = struct {
     mtx: std.Thread.Mutex,
-    sem: std.Thread.Semaphore,
+    job: ThreadPool.Latest,
     buf_ptr: [2]*[N]f32,
     bpm: f32,
-    quit: bool,
     buf: [2][N]f32,
     dft: [N]c32,
     bank: [n_bands][N]c32,
     hann: [N]c32,
     filt: [N]c32,
     bpm_graph: [2][n_bpm]f32,
+
+    /// Frame that completed the window in `buf_ptr[1]`
+    window_stamp: Stamp,
+
+    /// Frame of the window each `bpm_graph` was found in
+    graph_stamp: [2]Stamp,
 };
 
-thd: std.Thread,
+/// Null analyzes each window inline in `execute`
+pool: ?*ThreadPool,
 ctx: *Context,
 pos: usize,
+decimator: Resampler,
 
-pub fn init(alloc: std.mem.Allocator) !Self {
+/// Windows are analyzed on `pool` in the background, or inline without one
+pub fn init(pool: ?*ThreadPool, alloc: std.mem.Allocator) !Self {
     const ctx: *Context = @ptrCast(try alloc.alloc(Context, 1));
     errdefer alloc.free(ctx[0..1]);
 
+    var decimator = try Resampler.init(Config.sample_rate, sample_rate, 1, 2 * Config.windowSize(), alloc);
+    errdefer decimator.deinit(alloc);
+
     ctx.mtx = .{};
-    ctx.sem = .{};
+    ctx.job = ThreadPool.Latest.init(run);
     ctx.buf_ptr[0] = &ctx.buf[0];
     ctx.buf_ptr[1] = &ctx.buf[1];
     ctx.bpm = 0;
-    ctx.quit = false;
     @memset(&ctx.buf[1], 0);
     @memset(&ctx.bpm_graph[1], 0);
+    ctx.window_stamp = .{};
+    ctx.graph_stamp = .{ .{}, .{} };
 
     return .{
-        .thd = try std.Thread.spawn(.{}, thread_main, .{ctx}),
+        .pool = pool,
         .ctx = ctx,
         .pos = 0,
+        .decimator = decimator,
     };
 }
 
 pub fn deinit(self: *Self, alloc: std.mem.Allocator) void {
-    @atomicStore(bool, &self.ctx.quit, true, .release);
-    self.ctx.sem.post();
-    self.thd.join();
+    if (self.pool) |pool| pool.cancel(&self.ctx.job);
 
     alloc.free(self.ctx[0..1]);
+    self.decimator.deinit(alloc);
 }
 
 fn fft_fwd(samples: []c32) void {
@@ -89,11 +108,13 @@ fn fft_inv(samples: []c32) void {
 
 fn find_tempo(ctx: *Context) void {
     // Filterbank step
+    var stamp: Stamp = undefined;
     {
         ctx.mtx.lock();
         for (0..N) |i| {
             ctx.dft[i] = c32.init(ctx.buf_ptr[1][i], 0);
         }
+        stamp = ctx.window_stamp;
         ctx.mtx.unlock();
     }
     fft_fwd(&ctx.dft);
@@ -196,25 +217,24 @@ fn find_tempo(ctx: *Context) void {
         for (0..n_bpm) |bpm_i| {
             ctx.bpm_graph[1][bpm_i] = bpm_e[bpm_i] / e_max;
         }
+        ctx.graph_stamp[1] = stamp;
         ctx.mtx.unlock();
     }
 
     @atomicStore(f32, &ctx.bpm, s_bpm, .release);
 }
 
-fn thread_main(ctx: *Context) void {
-    while (true) {
-        ctx.sem.wait();
+fn run(job: *ThreadPool.Latest) void {
+    const ctx: *Context = @fieldParentPtr("job", job);
 
-        if (@atomicLoad(bool, &ctx.quit, .acquire)) {
-            return;
-        } else {
-            find_tempo(ctx);
-        }
-    }
+    const z = trace.zone("find tempo");
+    defer z.end();
+    find_tempo(ctx);
 }
 
-pub fn execute(self: *Self, samples: []const f32) void {
+/// Add the newest samples of analysis frame `frame`
+pub fn execute(self: *Self, input: []const f32, frame: Stamp) void {
+    const samples = self.decimator.process(input);
     var p: usize = 0;
 
     while (p < samples.len) {
@@ -228,8 +248,14 @@ pub fn execute(self: *Self, samples: []const f32) void {
             const buf_ptr = self.ctx.buf_ptr;
             self.ctx.buf_ptr[0] = buf_ptr[1];
             self.ctx.buf_ptr[1] = buf_ptr[0];
+            self.ctx.window_stamp = frame;
             self.ctx.mtx.unlock();
-            self.ctx.sem.post();
+
+            if (self.pool) |pool| {
+                pool.submit(&self.ctx.job);
+            } else {
+                run(&self.ctx.job);
+            }
 
             self.pos = 0;
         }
@@ -244,7 +270,14 @@ pub fn get_bpm_graph(self: *const Self) []const f32 {
     {
         self.ctx.mtx.lock();
         @memcpy(&self.ctx.bpm_graph[0], &self.ctx.bpm_graph[1]);
+        self.ctx.graph_stamp[0] = self.ctx.graph_stamp[1];
         self.ctx.mtx.unlock();
     }
     return &self.ctx.bpm_graph[0];
 }
+
+/// Frame the graph last returned by `get_bpm_graph` was found in. Only
+/// changes when a background run publishes a new graph.
+pub fn get_graph_stamp(self: *const Self) Stamp {
+    return self.ctx.graph_stamp[0];
+}
@@ -134,6 +134,138 @@ pub const RingBuffer = struct {
     }
 };
 
+/// Lock-free ring buffer shared by exactly one producer thread and one consumer thread.
+/// It holds several windows so the producer can run ahead of the consumer. Like
+/// `RingBuffer`, `receive` returns at most the newest `n` items and a full ring
+/// overwrites its oldest items, so a stalled consumer resumes with the newest audio.
+pub const SpscRingBuffer = struct {
+    /// Number of windows the ring can hold
+    const depth = 4;
+
+    buffer: []f32,
+    ring: []f32,
+
+    /// Total items received, only used by the consumer
+    head: std.atomic.Value(usize),
+
+    /// Total items sent, only written by the producer
+    tail: std.atomic.Value(usize),
+
+    /// `tail` once the send in progress completes, written by the producer before it
+    /// copies anything. Items before `reserved - ring.len` may have been overwritten.
+    reserved: std.atomic.Value(usize),
+
+    /// Initializes a ring buffer, allocating memory.
+    pub fn init(n: usize, allocator: std.mem.Allocator) !SpscRingBuffer {
+        const buffer = try allocator.alloc(f32, n);
+        errdefer allocator.free(buffer);
+
+        const ring = try allocator.alloc(f32, try std.math.ceilPowerOfTwo(usize, n * depth));
+        errdefer allocator.free(ring);
+
+        return SpscRingBuffer{
+            .buffer = buffer,
+            .ring = ring,
+            .head = std.atomic.Value(usize).init(0),
+            .tail = std.atomic.Value(usize).init(0),
+            .reserved = std.atomic.Value(usize).init(0),
+        };
+    }
+
+    /// Deinitializes a ring buffer, freeing memory.
+    pub fn deinit(self: *SpscRingBuffer, allocator: std.mem.Allocator) void {
+        allocator.free(self.buffer);
+        allocator.free(self.ring);
+        self.* = undefined;
+    }
+
+    /// Writes contents of buffer to the ring buffer, overwriting the oldest items on
+    /// overflow. Producer thread only.
+    pub fn send(self: *SpscRingBuffer, buffer: []const f32) void {
+        const tail = self.tail.load(.monotonic);
+        const next_tail = tail +% buffer.len;
+        const items = buffer[buffer.len - @min(buffer.len, self.ring.len) ..];
+
+        // Announce the overwrite before any item changes, see `receive`
+        self.reserved.store(next_tail, .monotonic);
+        @fence(.release);
+
+        self.copyIn(next_tail -% items.len, items);
+        self.tail.store(next_tail, .release);
+    }
+
+    /// Writes the newest contents of the ring buffer to the scratch buffer, returning them. Consumer thread only.
+    pub fn receive(self: *SpscRingBuffer) []const f32 {
+        const head = self.head.load(.monotonic);
+        const tail = self.tail.load(.acquire);
+
+        const len = @min(tail -% head, self.buffer.len);
+        const start = tail -% len;
+        self.copyOut(start, self.buffer[0..len]);
+        self.head.store(tail, .monotonic);
+
+        // Drop items a concurrent send overwrote while they were copied
+        @fence(.acquire);
+        const oldest = self.reserved.load(.monotonic) -% self.ring.len;
+        const overwritten: usize = if (@as(isize, @bitCast(oldest -% start)) > 0) oldest -% start else 0;
+
+        return self.buffer[@min(overwritten, len)..len];
+    }
+
+    fn copyIn(self: *SpscRingBuffer, at: usize, items: []const f32) void {
+        const start = at & (self.ring.len - 1);
+        const first = @min(items.len, self.ring.len - start);
+
+        @memcpy(self.ring[start .. start + first], items[0..first]);
+        @memcpy(self.ring[0 .. items.len - first], items[first..]);
+    }
+
+    fn copyOut(self: *SpscRingBuffer, at: usize, items: []f32) void {
+        const start = at & (self.ring.len - 1);
+        const first = @min(items.len, self.ring.len - start);
+
+        @memcpy(items[0..first], self.ring[start .. start + first]);
+        @memcpy(items[first..], self.ring[0 .. items.len - first]);
+    }
+};
+
+test "spsc ring buffer returns what was sent" {
+    var ring = try SpscRingBuffer.init(4, std.testing.allocator);
+    defer ring.deinit(std.testing.allocator);
+
+    ring.send(&.{ 1, 2, 3 });
+    try std.testing.expectEqualSlices(f32, &.{ 1, 2, 3 }, ring.receive());
+    try std.testing.expectEqual(0, ring.receive().len);
+}
+
+test "spsc ring buffer keeps the newest items past capacity" {
+    var ring = try SpscRingBuffer.init(4, std.testing.allocator);
+    defer ring.deinit(std.testing.allocator);
+
+    // A stalled consumer, the producer sends far more than the ring holds
+    var value: f32 = 0;
+    for (0..10) |_| {
+        var chunk: [5]f32 = undefined;
+        for (&chunk) |*x| {
+            value += 1;
+            x.* = value;
+        }
+        ring.send(&chunk);
+    }
+    try std.testing.expectEqualSlices(f32, &.{ 47, 48, 49, 50 }, ring.receive());
+
+    // One send longer than the whole ring
+    var long: [40]f32 = undefined;
+    for (&long, 0..) |*x, i| {
+        x.* = @floatFromInt(100 + i);
+    }
+    ring.send(&long);
+    try std.testing.expectEqualSlices(f32, &.{ 136, 137, 138, 139 }, ring.receive());
+
+    ring.send(&.{ 1, 2 });
+    try std.testing.expectEqualSlices(f32, &.{ 1, 2 }, ring.receive());
+}
+
 pub const RollBuffer = struct {
     buf: []f32,
     cap: usize,
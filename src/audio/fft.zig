@@ -184,6 +184,10 @@ inline fn sfft_eval(re: []f32, im: []f32, dir: Direction) void {
     }
 }
 
+/// Smoothed magnitudes below this are flushed to zero, so decaying
+/// towards silence never produces slow denormal values
+const flush_threshold = 1e-20;
+
 pub const FastFourierTransform = struct {
     result: []f32,
     scratch: []c32,
@@ -295,7 +299,16 @@ pub const FastFourierTransform = struct {
 
         // Exponential Moving Average (EMA) smoothing
         for (self.scratch[0 .. self.scratch.len >> 1], 0..) |z, i| {
-            self.result[i] = self.smoothing_factor * self.scaling_factor * z.magnitude() + (1.0 - self.smoothing_factor) * self.result[i];
+            const y = self.smoothing_factor * self.scaling_factor * z.magnitude() + (1.0 - self.smoothing_factor) * self.result[i];
+            self.result[i] = if (y < flush_threshold) 0.0 else y;
+        }
+    }
+
+    /// Scale the magnitudes towards zero without evaluating, for inputs known to be silent
+    pub fn decay(self: *FastFourierTransform, factor: f32) void {
+        for (self.result) |*y| {
+            const x = y.* * factor;
+            y.* = if (x < flush_threshold) 0.0 else x;
         }
     }
 
@@ -0,0 +1,70 @@
+const std = @import("std");
+const signal = @import("signal.zig");
+
+const Config = @import("../Config.zig");
+
+/// Capture backend producing a synthetic test signal in real time.
+/// The signal is described by `Config.process_id`, see `Signal.parse`.
+pub const GeneratorImpl = struct {
+    const log = std.log.scoped(.generator);
+
+    running: bool = false,
+
+    generator: signal.Generator,
+    buffer: []f32,
+    timer: std.time.Timer,
+
+    /// Elapsed time not yet rendered, in nanoseconds times the sample rate
+    pending: u64,
+
+    pub fn init(config: Config, allocator: std.mem.Allocator) !GeneratorImpl {
+        const sig = try signal.Signal.parse(config.process_id);
+        log.info("generating {s}", .{config.process_id});
+
+        return GeneratorImpl{
+            .generator = signal.Generator.init(sig, Config.sample_rate),
+            .buffer = try allocator.alloc(f32, Config.windowSize() / @sizeOf(f32)),
+            .timer = try std.time.Timer.start(),
+            .pending = 0,
+        };
+    }
+
+    pub fn deinit(self: *GeneratorImpl, allocator: std.mem.Allocator) void {
+        allocator.free(self.buffer);
+        self.* = undefined;
+    }
+
+    pub fn start(self: *GeneratorImpl) !void {
+        self.timer.reset();
+        self.pending = 0;
+        self.running = true;
+    }
+
+    pub fn stop(self: *GeneratorImpl) !void {
+        self.running = false;
+    }
+
+    /// Returns the frames that would have been captured since the last call.
+    pub fn sample(self: *GeneratorImpl) []const f32 {
+        if (!self.running) {
+            return self.buffer[0..0];
+        }
+
+        self.pending += self.timer.lap() * Config.sample_rate;
+
+        const capacity = self.buffer.len / Config.channel_count;
+        var frames: usize = @intCast(self.pending / std.time.ns_per_s);
+        self.pending -= frames * std.time.ns_per_s;
+
+        // Like a capture ring buffer, only the most recent window is kept.
+        if (frames > capacity) {
+            self.generator.skip(frames - capacity);
+            frames = capacity;
+        }
+
+        const out = self.buffer[0 .. frames * Config.channel_count];
+        self.generator.render(out);
+
+        return out;
+    }
+};
@@ -0,0 +1,345 @@
+//!
+//! Synthetic test signals with known ground truth (pitch, tempo, pan, ...)
+//!
+
+const std = @import("std");
+const Config = @import("../Config.zig");
+
+pub const Error = error{
+    invalid_signal,
+};
+
+pub const ChordType = enum {
+    major,
+    minor,
+
+    fn intervals(self: ChordType) [3]f64 {
+        return switch (self) {
+            .major => .{ 0, 4, 7 },
+            .minor => .{ 0, 3, 7 },
+        };
+    }
+};
+
+/// Highest frequency generated signals can hold, they are rendered at `Config.sample_rate`
+pub const nyquist = @as(f32, Config.sample_rate) / 2.0;
+
+pub const Signal = union(enum) {
+    /// All zeros
+    silence,
+
+    /// Gaussian noise
+    noise: struct {
+        amplitude: f32 = 0.25,
+    },
+
+    /// Noise for `on` seconds followed by silence for `off` seconds
+    burst: struct {
+        on: f32 = 2.0,
+        off: f32 = 2.0,
+        amplitude: f32 = 0.25,
+    },
+
+    /// Sine tone, `pan` ranges from -1 (left) to 1 (right)
+    sine: struct {
+        frequency: f32 = 440.0,
+        pan: f32 = 0.0,
+        amplitude: f32 = 0.5,
+    },
+
+    /// Logarithmic sine sweep from `from` to `to` Hz, restarting every `duration` seconds.
+    /// Both ends lie below `nyquist`.
+    sweep: struct {
+        from: f32 = 20.0,
+        to: f32 = 20000.0,
+        duration: f32 = 10.0,
+        amplitude: f32 = 0.5,
+    },
+
+    /// Short decaying clicks at exactly `bpm` beats per minute
+    click: struct {
+        bpm: f32 = 120.0,
+        amplitude: f32 = 0.8,
+    },
+
+    /// Triad with root pitch class `root` (C = 0), with three partials per tone
+    chord: struct {
+        root: u4 = 0,
+        type: ChordType = .major,
+        amplitude: f32 = 0.5,
+    },
+
+    /// Parse a signal description of the form `<kind>[:<param>[:<param>]]`:
+    ///
+    ///   silence
+    ///   noise[:amplitude]
+    ///   burst[:on[:off]]
+    ///   sine[:frequency[:pan]]
+    ///   sweep[:from[:to[:duration]]]
+    ///   click[:bpm]
+    ///   chord[:root[:major|minor]]
+    ///
+    /// Omitted parameters take their default value.
+    pub fn parse(spec: []const u8) Error!Signal {
+        var it = std.mem.splitScalar(u8, spec, ':');
+        const kind = std.meta.stringToEnum(std.meta.Tag(Signal), it.first()) orelse {
+            return Error.invalid_signal;
+        };
+
+        switch (kind) {
+            .silence => return .silence,
+            .noise => {
+                var s: Signal = .{ .noise = .{} };
+                if (it.next()) |p| s.noise.amplitude = try parseParam(p);
+                return s;
+            },
+            .burst => {
+                var s: Signal = .{ .burst = .{} };
+                if (it.next()) |p| s.burst.on = try parseParam(p);
+                if (it.next()) |p| s.burst.off = try parseParam(p);
+                return s;
+            },
+            .sine => {
+                var s: Signal = .{ .sine = .{} };
+                if (it.next()) |p| s.sine.frequency = try parseParam(p);
+                if (it.next()) |p| s.sine.pan = std.math.clamp(try parseParam(p), -1.0, 1.0);
+                return s;
+            },
+            .sweep => {
+                var s: Signal = .{ .sweep = .{} };
+                if (it.next()) |p| s.sweep.from = try parseParam(p);
+                if (it.next()) |p| s.sweep.to = try parseParam(p);
+                if (it.next()) |p| s.sweep.duration = try parseParam(p);
+                if (s.sweep.from <= 0 or s.sweep.to <= 0 or s.sweep.duration <= 0 or s.sweep.from >= nyquist or s.sweep.to >= nyquist) {
+                    return Error.invalid_signal;
+                }
+                return s;
+            },
+            .click => {
+                var s: Signal = .{ .click = .{} };
+                if (it.next()) |p| s.click.bpm = try parseParam(p);
+                if (s.click.bpm <= 0) {
+                    return Error.invalid_signal;
+                }
+                return s;
+            },
+            .chord => {
+                var s: Signal = .{ .chord = .{} };
+                if (it.next()) |p| s.chord.root = std.fmt.parseInt(u4, p, 10) catch return Error.invalid_signal;
+                if (it.next()) |p| s.chord.type = std.meta.stringToEnum(ChordType, p) orelse return Error.invalid_signal;
+                if (s.chord.root >= 12) {
+                    return Error.invalid_signal;
+                }
+                return s;
+            },
+        }
+    }
+
+    fn parseParam(param: []const u8) Error!f32 {
+        return std.fmt.parseFloat(f32, param) catch Error.invalid_signal;
+    }
+};
+
+/// Renders a signal as interleaved stereo frames. Output is fully
+/// determined by the signal and the number of frames rendered so far.
+pub const Generator = struct {
+    signal: Signal,
+    sample_rate: f64,
+
+    /// Number of frames rendered (or skipped) since init
+    frame: u64,
+
+    /// Oscillator phase in radians, used by sweeps
+    phase: f64,
+
+    rand: std.Random.DefaultPrng,
+
+    pub fn init(signal: Signal, sample_rate: u32) Generator {
+        return Generator{
+            .signal = signal,
+            .sample_rate = @floatFromInt(sample_rate),
+            .frame = 0,
+            .phase = 0.0,
+            .rand = std.Random.DefaultPrng.init(42),
+        };
+    }
+
+    /// Advance the signal without producing output.
+    pub fn skip(self: *Generator, frames: usize) void {
+        switch (self.signal) {
+            // The sweep phase is accumulated, so it has to be stepped through.
+            .sweep => for (0..frames) |_| {
+                _ = self.next();
+            },
+            else => self.frame += frames,
+        }
+    }
+
+    /// Fill `out` with interleaved stereo samples.
+    pub fn render(self: *Generator, out: []f32) void {
+        std.debug.assert(out.len % Config.channel_count == 0);
+
+        var i: usize = 0;
+        while (i < out.len) : (i += Config.channel_count) {
+            const frame = self.next();
+            out[i + 0] = frame[0];
+            out[i + 1] = frame[1];
+        }
+    }
+
+    fn next(self: *Generator) [2]f32 {
+        defer self.frame += 1;
+
+        const tau = std.math.tau;
+        const t = @as(f64, @floatFromInt(self.frame)) / self.sample_rate;
+
+        switch (self.signal) {
+            .silence => return .{ 0.0, 0.0 },
+            .noise => |s| {
+                const x = s.amplitude * self.rand.random().floatNorm(f32);
+                return .{ x, x };
+            },
+            .burst => |s| {
+                const on: f64 = s.on;
+                const off: f64 = s.off;
+                if (@mod(t, on + off) >= on) {
+                    return .{ 0.0, 0.0 };
+                }
+                const x = s.amplitude * self.rand.random().floatNorm(f32);
+                return .{ x, x };
+            },
+            .sine => |s| {
+                const frequency: f64 = s.frequency;
+                const x: f32 = s.amplitude * @as(f32, @floatCast(@sin(tau * frequency * t)));
+
+                // Constant power panning
+                const angle = (s.pan + 1.0) * std.math.pi / 4.0;
+                return .{ x * @cos(angle), x * @sin(angle) };
+            },
+            .sweep => |s| {
+                const from: f64 = s.from;
+                const to: f64 = s.to;
+                const duration: f64 = s.duration;
+                const frequency = from * std.math.pow(f64, to / from, @mod(t, duration) / duration);
+                self.phase = @mod(self.phase + tau * frequency / self.sample_rate, tau);
+
+                const x: f32 = s.amplitude * @as(f32, @floatCast(@sin(self.phase)));
+                return .{ x, x };
+            },
+            .click => |s| {
+                // Frames since the most recent beat, beats fall on exact multiples of the period
+                const bpm: f64 = s.bpm;
+                const period = 60.0 * self.sample_rate / bpm;
+                const since = @mod(@as(f64, @floatFromInt(self.frame)), period) / self.sample_rate;
+
+                const click_length = 0.005; // s
+                if (since >= click_length) {
+                    return .{ 0.0, 0.0 };
+                }
+
+                const envelope = @exp(-since / (click_length / 5.0));
+                const x: f32 = s.amplitude * @as(f32, @floatCast(envelope * @sin(tau * 2000.0 * since)));
+                return .{ x, x };
+            },
+            .chord => |s| {
+                // Root in the octave starting at C4
+                const c4 = 261.63;
+                const num_partials = 3;
+                var sum: f64 = 0.0;
+
+                for (s.type.intervals()) |interval| {
+                    const semitones = @as(f64, @floatFromInt(s.root)) + interval;
+                    const fundamental = c4 * std.math.pow(f64, 2.0, semitones / 12.0);
+
+                    for (1..num_partials + 1) |h| {
+                        const hf: f64 = @floatFromInt(h);
+                        sum += @sin(tau * fundamental * hf * t) / hf;
+                    }
+                }
+
+                const x: f32 = s.amplitude * @as(f32, @floatCast(sum / 3.0));
+                return .{ x, x };
+            },
+        }
+    }
+};
+
+test "parse reads parameters and defaults" {
+    try std.testing.expectEqual(@as(Signal, .silence), try Signal.parse("silence"));
+    try std.testing.expectEqual(Signal{ .noise = .{ .amplitude = 0.1 } }, try Signal.parse("noise:0.1"));
+    try std.testing.expectEqual(Signal{ .burst = .{ .on = 1.5, .off = 2.0 } }, try Signal.parse("burst:1.5"));
+    try std.testing.expectEqual(Signal{ .sine = .{ .frequency = 1000.0, .pan = -1.0 } }, try Signal.parse("sine:1000:-3"));
+    try std.testing.expectEqual(Signal{ .sweep = .{ .from = 50.0, .to = 5000.0, .duration = 2.0 } }, try Signal.parse("sweep:50:5000:2"));
+    try std.testing.expectEqual(Signal{ .click = .{ .bpm = 128.0 } }, try Signal.parse("click:128"));
+    try std.testing.expectEqual(Signal{ .chord = .{ .root = 9, .type = .minor } }, try Signal.parse("chord:9:minor"));
+    try std.testing.expectEqual(Signal{ .sine = .{} }, try Signal.parse("sine"));
+}
+
+test "parse rejects bad input" {
+    for ([_][]const u8{
+        "",
+        "square",
+        "sine:loud",
+        "noise:",
+        "sweep:0",
+        "sweep:20:30000",
+        "sweep:22050",
+        "sweep:20:200:-1",
+        "click:0",
+        "chord:12",
+        "chord:0:diminished",
+    }) |spec| {
+        try std.testing.expectError(Error.invalid_signal, Signal.parse(spec));
+    }
+}
+
+test "sine matches its frequency and amplitude" {
+    const frequency = 1000;
+    const amplitude = 0.5;
+
+    var generator = Generator.init(.{ .sine = .{ .frequency = frequency, .amplitude = amplitude } }, Config.sample_rate);
+    var out: [Config.sample_rate * Config.channel_count]f32 = undefined;
+    generator.render(&out);
+
+    var power: f64 = 0.0;
+    var crossings: usize = 0;
+    var i: usize = 0;
+    while (i < out.len) : (i += Config.channel_count) {
+        // Constant power panning keeps the power of both channels together
+        power += out[i] * out[i] + out[i + 1] * out[i + 1];
+        if (i > 0 and (out[i] < 0.0) != (out[i - Config.channel_count] < 0.0)) {
+            crossings += 1;
+        }
+    }
+
+    const rms = @sqrt(power / Config.sample_rate);
+    try std.testing.expectApproxEqRel(amplitude / std.math.sqrt2, rms, 1e-3);
+
+    // Two crossings per period over one second
+    try std.testing.expect(crossings >= 2 * frequency - 2 and crossings <= 2 * frequency + 2);
+}
+
+test "sweep reaches both ends" {
+    const from = 100.0;
+    const to = 10000.0;
+    const duration = 1.0;
+
+    var generator = Generator.init(.{ .sweep = .{ .from = from, .to = to, .duration = duration } }, Config.sample_rate);
+
+    // Phase advance per frame, in Hz
+    const Frequency = struct {
+        fn next(g: *Generator) f64 {
+            const before = g.phase;
+            _ = g.next();
+            return @mod(g.phase - before, std.math.tau) / (std.math.tau / g.sample_rate);
+        }
+    };
+
+    try std.testing.expectApproxEqRel(from, Frequency.next(&generator), 1e-3);
+
+    generator.skip(Config.sample_rate - 2);
+    try std.testing.expectApproxEqRel(to, Frequency.next(&generator), 1e-3);
+
+    // Restarts after `duration`
+    try std.testing.expectApproxEqRel(from, Frequency.next(&generator), 1e-3);
+}
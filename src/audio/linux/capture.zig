@@ -1,8 +1,10 @@
 const std = @import("std");
 const pulse = @import("pulse.zig");
 
-const RingBuffer = @import("../buffer.zig").RingBuffer;
+const RingBuffer = @import("../buffer.zig").SpscRingBuffer;
 const Config = @import("../Config.zig");
+const trace = @import("../../trace.zig");
+const sched = @import("../../sched.zig");
 
 pub const LinuxImpl = struct {
     const log = std.log.scoped(.pulseaudio);
@@ -20,9 +22,32 @@ pub const LinuxImpl = struct {
         proplist_init,
     };
 
+    /// Fragment duration requested in low latency mode, the server may grant more
+    const low_latency_ms = 5;
+
+    /// Latency of this many fragments means reads are not keeping up
+    const backlog_fragments = 4;
+
+    /// Reads in a row with a backlog before the fragment size is raised
+    const max_late_reads = 8;
+
     running: bool = false,
 
-    mutex: std.Thread.Mutex,
+    /// Currently requested fragment size in bytes, only touched with the mainloop locked
+    fragsize: u32,
+
+    /// Fragment size is never raised beyond one analysis window at `sample_rate`
+    max_fragsize: u32,
+
+    /// Reads in a row that found a backlog, only touched with the mainloop locked
+    late_reads: u32,
+
+    /// Capture latency reported by the server in microseconds, zero until measured
+    latency_us: std.atomic.Value(u64),
+
+    /// Native rate of the captured sink input
+    sample_rate: u32,
+
     ring_buffer: RingBuffer,
     mainloop: *pulse.pa_threaded_mainloop,
     context: *pulse.pa_context,
@@ -50,7 +75,20 @@ pub const LinuxImpl = struct {
         const sink_input_info = try SinkInputInfo.init(config, mainloop, context);
         log.info("sink input info initialized...", .{});
 
-        const stream = try Stream.init(&sink_input_info, mainloop, context);
+        // Capture at the rate the application plays at, it is resampled on our side
+        const sample_rate = sink_input_info.sample_spec.rate;
+        log.info("capturing at {d} Hz", .{sample_rate});
+
+        // Small fragments may be refused, in that case retry with larger ones
+        const max_fragsize = maxFragmentSize(sample_rate);
+        var fragsize: u32 = if (config.low_latency) fragmentSize(low_latency_ms, sample_rate) else max_fragsize;
+        var stream_result = Stream.init(&sink_input_info, mainloop, context, fragsize, sample_rate);
+        while (std.meta.isError(stream_result) and fragsize < max_fragsize) {
+            fragsize = @min(fragsize * 2, max_fragsize);
+            log.warn("stream refused, retrying with fragment size {d}", .{fragsize});
+            stream_result = Stream.init(&sink_input_info, mainloop, context, fragsize, sample_rate);
+        }
+        const stream = try stream_result;
         errdefer {
             pulse.pa_threaded_mainloop_lock(mainloop);
             _ = pulse.pa_stream_disconnect(stream);
@@ -58,11 +96,17 @@ pub const LinuxImpl = struct {
         }
         log.info("stream connected...", .{});
 
-        var ring_buffer = try RingBuffer.init(Config.windowSize() / @sizeOf(f32), allocator);
+        // Hold the same duration as at the default rate
+        const rate_ratio = std.math.divCeil(u32, sample_rate, Config.sample_rate) catch unreachable;
+        var ring_buffer = try RingBuffer.init(Config.windowSize() / @sizeOf(f32) * rate_ratio, allocator);
         errdefer ring_buffer.deinit(allocator);
 
         return LinuxImpl{
-            .mutex = .{},
+            .fragsize = fragsize,
+            .max_fragsize = max_fragsize,
+            .late_reads = 0,
+            .latency_us = std.atomic.Value(u64).init(0),
+            .sample_rate = sample_rate,
             .ring_buffer = ring_buffer,
             .mainloop = mainloop,
             .context = context,
@@ -105,31 +149,91 @@ pub const LinuxImpl = struct {
     }
 
     pub fn sample(self: *LinuxImpl) []const f32 {
-        self.mutex.lock();
-        defer self.mutex.unlock();
         return self.ring_buffer.receive();
     }
 
+    pub fn sampleRate(self: *const LinuxImpl) u32 {
+        return self.sample_rate;
+    }
+
+    /// Measured capture latency in microseconds, or null if not yet known.
+    pub fn latency(self: *const LinuxImpl) ?u64 {
+        const usec = self.latency_us.load(.acquire);
+        return if (usec == 0) null else usec;
+    }
+
+    const frame_size = Config.channel_count * Config.byteDepth();
+
+    /// Bytes of whole frames lasting `ms` at `sample_rate`
+    fn fragmentSize(ms: u32, sample_rate: u32) u32 {
+        return @intCast(@as(u64, ms) * sample_rate / 1000 * frame_size);
+    }
+
+    /// The duration of `Config.windowSize()` at `sample_rate`
+    fn maxFragmentSize(sample_rate: u32) u32 {
+        return @intCast(@as(u64, Config.windowSize() / frame_size) * sample_rate / Config.sample_rate * frame_size);
+    }
+
     fn captureLoop(stream: ?*pulse.pa_stream, nbytes: usize, userdata: ?*anyopaque) callconv(.C) void {
         var self: *LinuxImpl = @ptrCast(@alignCast(userdata.?));
+        sched.applyOnce(.capture);
+        const z = trace.zone("pulse read");
+        defer z.end();
+
         var buf: ?[*]f32 = undefined;
         var bytes: usize = nbytes;
 
+        var usec: pulse.pa_usec_t = 0;
+        var negative: c_int = 0;
+        if (pulse.pa_stream_get_latency(stream, &usec, &negative) == 0) {
+            self.latency_us.store(if (negative != 0) 1 else @max(usec, 1), .release);
+            self.checkBacklog(stream, if (negative != 0) 0 else usec);
+        }
+
         if (pulse.pa_stream_peek(stream, @ptrCast(@alignCast(&buf)), @ptrCast(@alignCast(&bytes))) < 0) {
             return;
         }
 
         if (buf) |okbuf| {
             const len = bytes / @sizeOf(f32);
-            self.mutex.lock();
             self.ring_buffer.send(okbuf[0..len]);
-            self.mutex.unlock();
             _ = pulse.pa_stream_drop(stream);
         } else if (bytes != 0) {
             _ = pulse.pa_stream_drop(stream);
         }
     }
 
+    /// Record streams get no overflow notification. A latency that stays several
+    /// fragments long means the fragments are too small to keep up, so the
+    /// fragment size is raised. Called with the mainloop locked.
+    fn checkBacklog(self: *LinuxImpl, stream: ?*pulse.pa_stream, usec: u64) void {
+        if (self.fragsize >= self.max_fragsize) {
+            return;
+        }
+
+        const bytes_per_second: u64 = @as(u64, self.sample_rate) * frame_size;
+        const fragment_us = @as(u64, self.fragsize) * std.time.us_per_s / bytes_per_second;
+
+        if (usec <= fragment_us * backlog_fragments) {
+            self.late_reads = 0;
+            return;
+        }
+
+        self.late_reads += 1;
+        if (self.late_reads < max_late_reads) {
+            return;
+        }
+        self.late_reads = 0;
+
+        self.fragsize = @min(self.fragsize * 2, self.max_fragsize);
+        log.warn("capture latency {d} us, increasing fragment size to {d}", .{ usec, self.fragsize });
+
+        const attr = Stream.bufferAttr(self.fragsize);
+        if (pulse.pa_stream_set_buffer_attr(stream, &attr, null, null)) |op| {
+            pulse.pa_operation_unref(op);
+        }
+    }
+
     const Context = struct {
         ok: bool,
         mainloop: *pulse.pa_threaded_mainloop,
@@ -219,8 +323,6 @@ pub const LinuxImpl = struct {
             if (std.mem.eql(u8, data.process_id, ptr[0..len])) {
                 data.ok = true;
                 data.sink_input_info = info.*;
-                if (info.sample_spec.rate != Config.sample_rate)
-                    std.log.warn("sink input samplerate {d} does not match hardcoded value {d}", .{ info.sample_spec.rate, Config.sample_rate });
             }
         }
     };
@@ -229,7 +331,7 @@ pub const LinuxImpl = struct {
         ok: bool,
         mainloop: *pulse.pa_threaded_mainloop,
 
-        pub fn init(sink_input_info: *const pulse.pa_sink_input_info, mainloop: *pulse.pa_threaded_mainloop, context: *pulse.pa_context) !*pulse.pa_stream {
+        pub fn init(sink_input_info: *const pulse.pa_sink_input_info, mainloop: *pulse.pa_threaded_mainloop, context: *pulse.pa_context, fragsize: u32, sample_rate: u32) !*pulse.pa_stream {
             const proplist = pulse.pa_proplist_new() orelse {
                 return Error.proplist_init;
             };
@@ -238,13 +340,18 @@ pub const LinuxImpl = struct {
 
             const sample_spec = pulse.pa_sample_spec{
                 .channels = Config.channel_count,
-                .rate = Config.sample_rate,
+                .rate = sample_rate,
                 .format = pulse.PA_SAMPLE_FLOAT32NE,
             };
 
             const stream = pulse.pa_stream_new_with_proplist(context, @ptrCast(@alignCast("pvk")), &sample_spec, null, proplist) orelse {
                 return Error.stream_init;
             };
+            errdefer {
+                pulse.pa_threaded_mainloop_lock(mainloop);
+                pulse.pa_stream_unref(stream);
+                pulse.pa_threaded_mainloop_unlock(mainloop);
+            }
 
             var userdata = Stream{
                 .ok = false,
@@ -252,14 +359,10 @@ pub const LinuxImpl = struct {
             };
 
             const dev: [*c]u8 = null;
-            const flags = pulse.PA_STREAM_START_CORKED | pulse.PA_STREAM_ADJUST_LATENCY;
-            const attr = pulse.pa_buffer_attr{
-                .maxlength = ~@as(u32, 0),
-                .tlength = ~@as(u32, 0),
-                .prebuf = ~@as(u32, 0),
-                .minreq = ~@as(u32, 0),
-                .fragsize = Config.windowSize(),
-            };
+            // Timing updates are needed for pa_stream_get_latency
+            const flags = pulse.PA_STREAM_START_CORKED | pulse.PA_STREAM_ADJUST_LATENCY |
+                pulse.PA_STREAM_INTERPOLATE_TIMING | pulse.PA_STREAM_AUTO_TIMING_UPDATE;
+            const attr = bufferAttr(fragsize);
 
             pulse.pa_threaded_mainloop_lock(mainloop);
             pulse.pa_stream_set_state_callback(stream, callback, &userdata);
@@ -274,11 +377,25 @@ pub const LinuxImpl = struct {
 
             pulse.pa_threaded_mainloop_lock(mainloop);
             pulse.pa_stream_set_state_callback(stream, nil, null);
+            const granted = pulse.pa_stream_get_buffer_attr(stream);
+            if (granted != null) {
+                log.info("fragment size requested {d}, granted {d}", .{ fragsize, granted.*.fragsize });
+            }
             pulse.pa_threaded_mainloop_unlock(mainloop);
 
             return stream;
         }
 
+        fn bufferAttr(fragsize: u32) pulse.pa_buffer_attr {
+            return pulse.pa_buffer_attr{
+                .maxlength = ~@as(u32, 0),
+                .tlength = ~@as(u32, 0),
+                .prebuf = ~@as(u32, 0),
+                .minreq = ~@as(u32, 0),
+                .fragsize = fragsize,
+            };
+        }
+
         fn callback(stream: ?*pulse.pa_stream, userdata: ?*anyopaque) callconv(.C) void {
             var data: *Stream = @ptrCast(@alignCast(userdata.?));
             const state = pulse.pa_stream_get_state(stream);
@@ -1,6 +1,8 @@
 const std = @import("std");
 const Config = @import("../Config.zig");
-const RingBuffer = @import("../buffer.zig").RingBuffer;
+const trace = @import("../../trace.zig");
+const sched = @import("../../sched.zig");
+const RingBuffer = @import("../buffer.zig").SpscRingBuffer;
 const coreaudio = @import("coreaudio.zig");
 
 pub const MacOSImpl = struct {
@@ -35,7 +37,6 @@ pub const MacOSImpl = struct {
         instance: *c.AudioComponentInstance,
         buffer_list: *c.AudioBufferList,
         ring_buffer: RingBuffer,
-        mutex: std.Thread.Mutex,
         device_id: c.UInt32,
     };
     data: *UserData,
@@ -183,7 +184,6 @@ pub const MacOSImpl = struct {
             .instance = instance_ptr,
             .buffer_list = buffer_list,
             .ring_buffer = ring_buffer,
-            .mutex = .{},
             .device_id = device_id,
         };
         const input_callback = c.AURenderCallbackStruct{
@@ -248,14 +248,15 @@ pub const MacOSImpl = struct {
     }
 
     pub fn sample(self: *MacOSImpl) []const f32 {
-        self.data.mutex.lock();
-        defer self.data.mutex.unlock();
         return self.data.ring_buffer.receive();
     }
 
     fn read_callback_ca(userdata0: ?*anyopaque, io_action_flags: [*c]c.AudioUnitRenderActionFlags, in_time_stamp: [*c]const c.AudioTimeStamp, in_bus_number: c.UInt32, in_number_frames: c.UInt32, io_data: [*c]c.AudioBufferList) callconv(.C) c.OSStatus {
         _ = io_data;
         const userdata: *UserData = @ptrCast(@alignCast(userdata0));
+        sched.applyOnce(.capture);
+        const z = trace.zone("coreaudio read");
+        defer z.end();
 
         const err = c.AudioUnitRender(userdata.instance.*, io_action_flags, in_time_stamp, in_bus_number, in_number_frames, @ptrCast(userdata.buffer_list));
         if (err != 0) {
@@ -267,9 +268,7 @@ pub const MacOSImpl = struct {
             const buf = userdata.buffer_list.mBuffers[i];
             const data: [*]f32 = @ptrCast(@alignCast(buf.mData));
             const length = buf.mDataByteSize / @sizeOf(f32);
-            userdata.mutex.lock();
             userdata.ring_buffer.send(data[0..length]);
-            userdata.mutex.unlock();
             // log.info("Got data with length = {}", .{length});
             // std.debug.print("Buffer %d has %zu floats with %d channels.\n", i, length, buf.mNumberChannels);
             // for (0..length) |j| {
@@ -1,8 +1,11 @@
 const std = @import("std");
 const FFT = @import("fft.zig").FastFourierTransform;
 const Tempo = @import("Tempo.zig");
+const Config = @import("Config.zig");
 
-const s: f32 = @floatFromInt(@import("Config.zig").sample_rate);
+/// Spectral flatness spans the full band up to Nyquist, and the centroids in
+/// `Mood.values` were measured that way, so mood runs at the capture rate
+const s: f32 = @floatFromInt(Config.sample_rate);
 
 // https://sites.tufts.edu/eeseniordesignhandbook/2015/music-mood-classification/
 // Intensity increases with rms
@@ -64,9 +67,19 @@ pub const MoodAnalyzer = struct {
     }
 
     pub fn analyze(self: *MoodAnalyzer, audio: []const f32) void {
-        const alpha = 0.01;
+        self.write(audio);
+        self.evaluate();
+    }
 
+    /// Feed audio without updating the mood
+    pub fn write(self: *MoodAnalyzer, audio: []const f32) void {
         self.fft.write(audio);
+    }
+
+    /// Update the mood from the audio written so far
+    pub fn evaluate(self: *MoodAnalyzer) void {
+        const alpha = 0.01;
+
         self.fft.evaluate();
 
         const intensity: f32 = rootMeanSquare(self.fft.read());
@@ -0,0 +1,367 @@
+const std = @import("std");
+const pw = @import("pipewire.zig");
+
+const RingBuffer = @import("../buffer.zig").SpscRingBuffer;
+const Config = @import("../Config.zig");
+const trace = @import("../../trace.zig");
+const sched = @import("../../sched.zig");
+
+/// Captures the output of an application's PipeWire stream node directly,
+/// without going through the PulseAudio compatibility layer.
+pub const PipeWireImpl = struct {
+    const log = std.log.scoped(.pipewire);
+
+    const Error = error{
+        loop_init,
+        loop_start,
+        context_init,
+        core_connect,
+        registry_init,
+        node_not_found,
+        stream_init,
+        stream_connect,
+        format_negotiation,
+        capture_start,
+        capture_stop,
+        timeout,
+    };
+
+    /// Seconds to wait for the server before giving up
+    const timeout_s = 2;
+
+    /// Callbacks point here, so it is heap allocated to keep its address
+    const State = struct {
+        loop: ?*pw.pw_thread_loop = null,
+        context: ?*pw.pw_context = null,
+        core: ?*pw.pw_core = null,
+        core_listener: pw.spa_hook = std.mem.zeroes(pw.spa_hook),
+        registry_listener: pw.spa_hook = std.mem.zeroes(pw.spa_hook),
+        stream: ?*pw.pw_stream = null,
+        stream_listener: pw.spa_hook = std.mem.zeroes(pw.spa_hook),
+
+        process_id: []const u8,
+
+        /// Serial of the application's output stream node, as a string for `target.object`
+        target: ?[32:0]u8 = null,
+
+        sync_seq: c_int = 0,
+        synced: bool = false,
+        failed: bool = false,
+
+        /// Negotiated rate, zero until the format is known
+        sample_rate: u32 = 0,
+
+        /// Written from the realtime data thread once the stream is active
+        ring_buffer: ?RingBuffer = null,
+
+        /// Tear down whatever was set up, the loop must not be locked
+        fn teardown(self: *State) void {
+            if (self.loop) |loop| {
+                pw.pw_thread_loop_stop(loop);
+            }
+            if (self.stream) |stream| {
+                pw.pw_stream_destroy(stream);
+            }
+            if (self.core) |core| {
+                _ = pw.pw_core_disconnect(core);
+            }
+            if (self.context) |context| {
+                pw.pw_context_destroy(context);
+            }
+            if (self.loop) |loop| {
+                pw.pw_thread_loop_destroy(loop);
+            }
+        }
+
+        /// Wait for the server to process everything sent so far. Called with the loop locked.
+        fn roundtrip(self: *State) !void {
+            self.synced = false;
+            self.sync_seq = pw.bob_pw_core_sync(self.core, 0);
+
+            while (!self.synced) {
+                if (pw.pw_thread_loop_timed_wait(self.loop, timeout_s) != 0) {
+                    return Error.timeout;
+                }
+            }
+        }
+    };
+
+    state: *State,
+
+    pub fn init(config: Config, allocator: std.mem.Allocator) !PipeWireImpl {
+        pw.pw_init(null, null);
+        errdefer pw.pw_deinit();
+
+        const state = try allocator.create(State);
+        errdefer allocator.destroy(state);
+        state.* = .{ .process_id = config.process_id };
+
+        errdefer state.teardown();
+
+        state.loop = pw.pw_thread_loop_new("bob-capture", null) orelse {
+            return Error.loop_init;
+        };
+
+        state.context = pw.pw_context_new(pw.pw_thread_loop_get_loop(state.loop), null, 0) orelse {
+            return Error.context_init;
+        };
+
+        if (pw.pw_thread_loop_start(state.loop) < 0) {
+            return Error.loop_start;
+        }
+        log.info("thread loop started...", .{});
+
+        pw.pw_thread_loop_lock(state.loop);
+        const result = connect(state);
+        pw.pw_thread_loop_unlock(state.loop);
+        try result;
+
+        log.info("capturing node {s} at {d} Hz", .{ std.mem.sliceTo(&state.target.?, 0), state.sample_rate });
+
+        // Hold the same duration as at the default rate
+        const rate_ratio = std.math.divCeil(u32, state.sample_rate, Config.sample_rate) catch unreachable;
+        state.ring_buffer = try RingBuffer.init(Config.windowSize() / @sizeOf(f32) * rate_ratio, allocator);
+
+        return PipeWireImpl{ .state = state };
+    }
+
+    pub fn deinit(self: *PipeWireImpl, allocator: std.mem.Allocator) void {
+        self.state.teardown();
+        log.info("stream destroyed...", .{});
+
+        if (self.state.ring_buffer) |*ring_buffer| {
+            ring_buffer.deinit(allocator);
+        }
+        allocator.destroy(self.state);
+        pw.pw_deinit();
+
+        self.* = undefined;
+    }
+
+    pub fn start(self: *PipeWireImpl) !void {
+        pw.pw_thread_loop_lock(self.state.loop);
+        defer pw.pw_thread_loop_unlock(self.state.loop);
+
+        if (pw.pw_stream_set_active(self.state.stream, true) < 0) {
+            return Error.capture_start;
+        }
+    }
+
+    pub fn stop(self: *PipeWireImpl) !void {
+        pw.pw_thread_loop_lock(self.state.loop);
+        defer pw.pw_thread_loop_unlock(self.state.loop);
+
+        if (pw.pw_stream_set_active(self.state.stream, false) < 0) {
+            return Error.capture_stop;
+        }
+    }
+
+    pub fn sample(self: *PipeWireImpl) []const f32 {
+        return self.state.ring_buffer.?.receive();
+    }
+
+    pub fn sampleRate(self: *const PipeWireImpl) u32 {
+        return self.state.sample_rate;
+    }
+
+    /// Find the target node and connect an inactive stream to it. Called with the loop locked.
+    fn connect(state: *State) !void {
+        state.core = pw.pw_context_connect(state.context, null, 0) orelse {
+            return Error.core_connect;
+        };
+        _ = pw.bob_pw_core_add_listener(state.core, &state.core_listener, &core_events, state);
+        log.info("core connected...", .{});
+
+        const registry = pw.bob_pw_core_get_registry(state.core) orelse {
+            return Error.registry_init;
+        };
+        defer pw.pw_proxy_destroy(@ptrCast(registry));
+
+        _ = pw.bob_pw_registry_add_listener(registry, &state.registry_listener, &registry_events, state);
+        try state.roundtrip();
+
+        const target = state.target orelse {
+            return Error.node_not_found;
+        };
+
+        const props = pw.pw_properties_new(
+            pw.PW_KEY_MEDIA_TYPE,
+            "Audio",
+            pw.PW_KEY_MEDIA_CATEGORY,
+            "Capture",
+            pw.PW_KEY_MEDIA_ROLE,
+            "Music",
+            pw.PW_KEY_TARGET_OBJECT,
+            @as([*:0]const u8, &target),
+            @as(?*anyopaque, null),
+        );
+
+        // The stream takes ownership of props
+        state.stream = pw.pw_stream_new(state.core, "bob", props) orelse {
+            return Error.stream_init;
+        };
+        pw.pw_stream_add_listener(state.stream, &state.stream_listener, &stream_events, state);
+
+        var format_buffer: [1024]u8 = undefined;
+        var params = [_][*c]const pw.spa_pod{
+            pw.bob_pw_build_format(&format_buffer, format_buffer.len, Config.channel_count),
+        };
+
+        // Buffers are mapped and read in place on the realtime data thread
+        const Flags = pw.pw_stream_flags;
+        const flags = @as(Flags, pw.PW_STREAM_FLAG_AUTOCONNECT) | @as(Flags, pw.PW_STREAM_FLAG_INACTIVE) |
+            @as(Flags, pw.PW_STREAM_FLAG_MAP_BUFFERS) | @as(Flags, pw.PW_STREAM_FLAG_RT_PROCESS);
+
+        if (pw.pw_stream_connect(state.stream, pw.PW_DIRECTION_INPUT, pw.PW_ID_ANY, flags, &params, params.len) < 0) {
+            return Error.stream_connect;
+        }
+
+        while (state.sample_rate == 0) {
+            if (state.failed) {
+                return Error.format_negotiation;
+            }
+            if (pw.pw_thread_loop_timed_wait(state.loop, timeout_s) != 0) {
+                return Error.timeout;
+            }
+        }
+    }
+
+    const core_events = pw.pw_core_events{
+        .version = pw.PW_VERSION_CORE_EVENTS,
+        .done = coreDone,
+        .@"error" = coreError,
+    };
+
+    fn coreDone(userdata: ?*anyopaque, id: u32, seq: c_int) callconv(.C) void {
+        const state: *State = @ptrCast(@alignCast(userdata.?));
+
+        if (id == pw.PW_ID_CORE and seq == state.sync_seq) {
+            state.synced = true;
+            pw.pw_thread_loop_signal(state.loop, false);
+        }
+    }
+
+    fn coreError(userdata: ?*anyopaque, id: u32, seq: c_int, res: c_int, message: [*c]const u8) callconv(.C) void {
+        const state: *State = @ptrCast(@alignCast(userdata.?));
+        _ = seq;
+
+        log.err("server error on object {d}: {s} ({d})", .{ id, message, res });
+
+        if (id == pw.PW_ID_CORE) {
+            state.failed = true;
+            pw.pw_thread_loop_signal(state.loop, false);
+        }
+    }
+
+    const registry_events = pw.pw_registry_events{
+        .version = pw.PW_VERSION_REGISTRY_EVENTS,
+        .global = registryGlobal,
+    };
+
+    /// Pick the audio output stream node owned by the requested process
+    fn registryGlobal(
+        userdata: ?*anyopaque,
+        id: u32,
+        permissions: u32,
+        object_type: [*c]const u8,
+        version: u32,
+        props: [*c]const pw.spa_dict,
+    ) callconv(.C) void {
+        const state: *State = @ptrCast(@alignCast(userdata.?));
+        _ = permissions;
+        _ = version;
+
+        if (state.target != null or props == null or !std.mem.eql(u8, std.mem.span(object_type), pw.PW_TYPE_INTERFACE_Node)) {
+            return;
+        }
+
+        const process_id = pw.bob_pw_dict_lookup(props, pw.PW_KEY_APPLICATION_PROCESS_ID) orelse return;
+        const media_class = pw.bob_pw_dict_lookup(props, pw.PW_KEY_MEDIA_CLASS) orelse return;
+
+        if (!std.mem.eql(u8, std.mem.span(process_id), state.process_id) or
+            !std.mem.eql(u8, std.mem.span(media_class), "Stream/Output/Audio"))
+        {
+            return;
+        }
+
+        var target: [32:0]u8 = undefined;
+        if (pw.bob_pw_dict_lookup(props, pw.PW_KEY_OBJECT_SERIAL)) |serial| {
+            _ = std.fmt.bufPrintZ(&target, "{s}", .{serial}) catch return;
+        } else {
+            _ = std.fmt.bufPrintZ(&target, "{d}", .{id}) catch return;
+        }
+
+        state.target = target;
+    }
+
+    const stream_events = pw.pw_stream_events{
+        .version = pw.PW_VERSION_STREAM_EVENTS,
+        .state_changed = streamStateChanged,
+        .param_changed = streamParamChanged,
+        .process = streamProcess,
+    };
+
+    fn streamStateChanged(
+        userdata: ?*anyopaque,
+        old: pw.pw_stream_state,
+        new: pw.pw_stream_state,
+        message: [*c]const u8,
+    ) callconv(.C) void {
+        const state: *State = @ptrCast(@alignCast(userdata.?));
+        _ = old;
+
+        if (new == pw.PW_STREAM_STATE_ERROR) {
+            log.err("stream error: {s}", .{message});
+            state.failed = true;
+            pw.pw_thread_loop_signal(state.loop, false);
+        }
+    }
+
+    fn streamParamChanged(userdata: ?*anyopaque, id: u32, param: [*c]const pw.spa_pod) callconv(.C) void {
+        const state: *State = @ptrCast(@alignCast(userdata.?));
+
+        if (param == null or id != pw.SPA_PARAM_Format) {
+            return;
+        }
+
+        const rate = pw.bob_pw_format_rate(param);
+        if (rate == 0) {
+            state.failed = true;
+        } else if (state.sample_rate != 0 and rate != state.sample_rate) {
+            // The mixer's resampler is set up for the first rate
+            log.warn("stream renegotiated from {d} Hz to {d} Hz", .{ state.sample_rate, rate });
+        } else {
+            state.sample_rate = rate;
+        }
+
+        pw.pw_thread_loop_signal(state.loop, false);
+    }
+
+    /// Runs on the realtime data thread, must not block or allocate
+    fn streamProcess(userdata: ?*anyopaque) callconv(.C) void {
+        const state: *State = @ptrCast(@alignCast(userdata.?));
+        sched.applyOnce(.capture);
+        const z = trace.zone("pipewire process");
+        defer z.end();
+
+        const buffer = pw.pw_stream_dequeue_buffer(state.stream) orelse return;
+        defer _ = pw.pw_stream_queue_buffer(state.stream, buffer);
+
+        const spa_buffer = buffer.*.buffer orelse return;
+        if (spa_buffer.*.n_datas == 0) {
+            return;
+        }
+
+        const data = spa_buffer.*.datas[0];
+        const bytes: [*]const u8 = @ptrCast(data.data orelse return);
+        const chunk = data.chunk orelse return;
+
+        const offset = @min(chunk.*.offset, data.maxsize);
+        const size = @min(chunk.*.size, data.maxsize - offset);
+        const samples: [*]const f32 = @ptrCast(@alignCast(bytes + offset));
+
+        if (state.ring_buffer) |*ring_buffer| {
+            ring_buffer.send(samples[0 .. size / @sizeOf(f32)]);
+        }
+    }
+};
@@ -0,0 +1,5 @@
+pub usingnamespace @cImport({
+    @cInclude("pipewire/pipewire.h");
+    @cInclude("spa/param/audio/format.h");
+    @cInclude("shim.h");
+});
@@ -0,0 +1,57 @@
+#include "shim.h"
+
+#include <spa/param/audio/format-utils.h>
+
+int bob_pw_core_add_listener(struct pw_core *core, struct spa_hook *listener,
+                             const struct pw_core_events *events, void *data)
+{
+    return pw_core_add_listener(core, listener, events, data);
+}
+
+int bob_pw_core_sync(struct pw_core *core, int seq)
+{
+    return pw_core_sync(core, PW_ID_CORE, seq);
+}
+
+struct pw_registry *bob_pw_core_get_registry(struct pw_core *core)
+{
+    return pw_core_get_registry(core, PW_VERSION_REGISTRY, 0);
+}
+
+int bob_pw_registry_add_listener(struct pw_registry *registry, struct spa_hook *listener,
+                                 const struct pw_registry_events *events, void *data)
+{
+    return pw_registry_add_listener(registry, listener, events, data);
+}
+
+const char *bob_pw_dict_lookup(const struct spa_dict *dict, const char *key)
+{
+    return spa_dict_lookup(dict, key);
+}
+
+const struct spa_pod *bob_pw_build_format(uint8_t *buffer, uint32_t size, uint32_t channels)
+{
+    struct spa_pod_builder builder = SPA_POD_BUILDER_INIT(buffer, size);
+    struct spa_audio_info_raw info = SPA_AUDIO_INFO_RAW_INIT(
+            .format = SPA_AUDIO_FORMAT_F32,
+            .channels = channels);
+
+    return spa_format_audio_raw_build(&builder, SPA_PARAM_EnumFormat, &info);
+}
+
+uint32_t bob_pw_format_rate(const struct spa_pod *param)
+{
+    uint32_t media_type, media_subtype;
+    struct spa_audio_info_raw info = { 0 };
+
+    if (spa_format_parse(param, &media_type, &media_subtype) < 0)
+        return 0;
+
+    if (media_type != SPA_MEDIA_TYPE_audio || media_subtype != SPA_MEDIA_SUBTYPE_raw)
+        return 0;
+
+    if (spa_format_audio_raw_parse(param, &info) < 0)
+        return 0;
+
+    return info.rate;
+}
@@ -0,0 +1,29 @@
+/*
+ * Wrappers for the parts of the PipeWire API that are macros or
+ * static inline functions, which Zig cannot translate.
+ */
+
+#ifndef BOB_PIPEWIRE_SHIM_H
+#define BOB_PIPEWIRE_SHIM_H
+
+#include <pipewire/pipewire.h>
+
+int bob_pw_core_add_listener(struct pw_core *core, struct spa_hook *listener,
+                             const struct pw_core_events *events, void *data);
+
+int bob_pw_core_sync(struct pw_core *core, int seq);
+
+struct pw_registry *bob_pw_core_get_registry(struct pw_core *core);
+
+int bob_pw_registry_add_listener(struct pw_registry *registry, struct spa_hook *listener,
+                                 const struct pw_registry_events *events, void *data);
+
+const char *bob_pw_dict_lookup(const struct spa_dict *dict, const char *key);
+
+/* Build an interleaved float32 format with `channels` channels and any rate into `buffer` */
+const struct spa_pod *bob_pw_build_format(uint8_t *buffer, uint32_t size, uint32_t channels);
+
+/* Rate of a negotiated SPA_PARAM_Format, or 0 if it is not raw audio */
+uint32_t bob_pw_format_rate(const struct spa_pod *param);
+
+#endif
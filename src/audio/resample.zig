@@ -0,0 +1,171 @@
+//!
+//! Streaming polyphase sample rate conversion by a rational factor
+//!
+
+const std = @import("std");
+const WindowFunction = @import("fft.zig").WindowFunction;
+
+const vector_len = std.simd.suggestVectorLength(f32) orelse 4;
+const Vec = @Vector(vector_len, f32);
+
+/// Taps per phase for each multiple of the downsampling factor
+const taps_per_ratio = 16;
+
+/// Fraction of the output Nyquist frequency that is passed
+const passband = 0.9;
+
+/// Converts interleaved audio from one sample rate to another, upsampling by `up`
+/// and downsampling by `down`. With `up` = 1 this is a decimating low-pass filter.
+pub const Resampler = struct {
+    channels: usize,
+    up: usize,
+    down: usize,
+
+    /// Taps per phase, a multiple of the vector length
+    taps: usize,
+
+    /// `up` phases of `taps` coefficients each, stored reversed so each
+    /// output is a dot product with a contiguous run of input samples
+    bank: []f32,
+
+    /// Per channel input, the first `taps - 1` samples are history from earlier calls
+    work: [][]f32,
+
+    /// Work index of the newest input sample of the next output, and its phase
+    index: usize,
+    phase: usize,
+
+    /// Interleaved output
+    out: []f32,
+
+    max_frames: usize,
+
+    /// `max_frames` is the largest number of input frames passed to `process` at once.
+    pub fn init(from_rate: u32, to_rate: u32, channels: usize, max_frames: usize, allocator: std.mem.Allocator) !Resampler {
+        const gcd = std.math.gcd(from_rate, to_rate);
+        const up: usize = to_rate / gcd;
+        const down: usize = from_rate / gcd;
+
+        const taps = std.mem.alignForward(usize, taps_per_ratio * std.math.divCeil(usize, down, up) catch unreachable, vector_len);
+
+        const bank = try allocator.alloc(f32, up * taps);
+        errdefer allocator.free(bank);
+        design(bank, up, down, taps);
+
+        const work = try allocator.alloc([]f32, channels);
+        errdefer allocator.free(work);
+
+        for (work, 0..) |*w, i| {
+            errdefer for (work[0..i]) |prev| allocator.free(prev);
+            w.* = try allocator.alloc(f32, taps - 1 + max_frames);
+            @memset(w.*, 0);
+        }
+        errdefer for (work) |w| allocator.free(w);
+
+        const out = try allocator.alloc(f32, channels * (max_frames * up / down + 2));
+        errdefer allocator.free(out);
+
+        return Resampler{
+            .channels = channels,
+            .up = up,
+            .down = down,
+            .taps = taps,
+            .bank = bank,
+            .work = work,
+            .index = taps - 1,
+            .phase = 0,
+            .out = out,
+            .max_frames = max_frames,
+        };
+    }
+
+    pub fn deinit(self: *Resampler, allocator: std.mem.Allocator) void {
+        allocator.free(self.bank);
+        for (self.work) |w| allocator.free(w);
+        allocator.free(self.work);
+        allocator.free(self.out);
+        self.* = undefined;
+    }
+
+    /// Resample interleaved `input`, returning the interleaved output. It is valid until the next call.
+    pub fn process(self: *Resampler, input: []const f32) []const f32 {
+        const history = self.taps - 1;
+        const frames = @min(input.len / self.channels, self.max_frames);
+
+        // Drop the oldest input if more than fits was passed
+        const first = input.len / self.channels - frames;
+
+        for (self.work, 0..) |w, c| {
+            for (w[history .. history + frames], first..) |*x, i| {
+                x.* = input[i * self.channels + c];
+            }
+        }
+
+        const end = history + frames;
+        var n: usize = 0;
+
+        while (self.index < end) : (n += 1) {
+            const coefficients = self.bank[self.phase * self.taps ..][0..self.taps];
+
+            for (self.work, 0..) |w, c| {
+                self.out[n * self.channels + c] = dot(w[self.index + 1 - self.taps .. self.index + 1], coefficients);
+            }
+
+            self.phase += self.down;
+            self.index += self.phase / self.up;
+            self.phase %= self.up;
+        }
+
+        for (self.work) |w| {
+            std.mem.copyForwards(f32, w[0..history], w[frames..end]);
+        }
+        self.index -= frames;
+
+        return self.out[0 .. n * self.channels];
+    }
+
+    /// Windowed sinc low-pass, split into `up` phases
+    fn design(bank: []f32, up: usize, down: usize, taps: usize) void {
+        const len = up * taps;
+        const cutoff = passband * 0.5 / @as(f32, @floatFromInt(@max(up, down)));
+        const center = @as(f32, @floatFromInt(len - 1)) / 2.0;
+
+        for (0..up) |phase| {
+            var sum: f32 = 0.0;
+
+            for (0..taps) |k| {
+                const i = k * up + phase;
+                const t = @as(f32, @floatFromInt(i)) - center;
+                const x = 2.0 * cutoff * t;
+                const sinc = if (t == 0.0) 1.0 else @sin(std.math.pi * x) / (std.math.pi * x);
+                const h = 2.0 * cutoff * sinc * WindowFunction.blackman.call(len, i);
+
+                bank[phase * taps + (taps - 1 - k)] = h;
+                sum += h;
+            }
+
+            // Unity gain at DC for every phase
+            for (bank[phase * taps ..][0..taps]) |*h| {
+                h.* /= sum;
+            }
+        }
+    }
+};
+
+fn dot(a: []const f32, b: []const f32) f32 {
+    var acc: Vec = @splat(0.0);
+    var i: usize = 0;
+
+    while (i + vector_len <= a.len) : (i += vector_len) {
+        const x: Vec = a[i..][0..vector_len].*;
+        const y: Vec = b[i..][0..vector_len].*;
+        acc += x * y;
+    }
+
+    var sum = @reduce(.Add, acc);
+    while (i < a.len) : (i += 1) {
+        sum += a[i] * b[i];
+    }
+
+    return sum;
+}
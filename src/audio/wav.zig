@@ -0,0 +1,264 @@
+//!
+//! Minimal streaming reader for RIFF/WAVE files
+//!
+
+const std = @import("std");
+const Config = @import("Config.zig");
+
+pub const Error = error{
+    invalid_header,
+    unsupported_format,
+};
+
+const Encoding = enum {
+    unsigned8,
+    signed16,
+    signed24,
+    signed32,
+    float32,
+};
+
+const format_pcm = 0x0001;
+const format_ieee_float = 0x0003;
+const format_extensible = 0xFFFE;
+
+const max_block_align = 64;
+
+pub const Reader = struct {
+    file: std.fs.File,
+    buffered: std.io.BufferedReader(4096, std.fs.File.Reader),
+    encoding: Encoding,
+    channels: u16,
+    sample_rate: u32,
+    block_align: u16,
+
+    /// Frames remaining in the data chunk
+    frames_left: usize,
+
+    pub fn open(path: []const u8) !Reader {
+        const file = try std.fs.cwd().openFile(path, .{ .mode = .read_only });
+        errdefer file.close();
+
+        return fromFile(file);
+    }
+
+    /// Read the header of an open file. The reader owns the file once this succeeds.
+    pub fn fromFile(file: std.fs.File) !Reader {
+        var buffered = std.io.bufferedReader(file.reader());
+        const reader = buffered.reader();
+
+        if (!std.mem.eql(u8, &try reader.readBytesNoEof(4), "RIFF")) return Error.invalid_header;
+        _ = try reader.readInt(u32, .little);
+        if (!std.mem.eql(u8, &try reader.readBytesNoEof(4), "WAVE")) return Error.invalid_header;
+
+        var encoding: ?Encoding = null;
+        var channels: u16 = 0;
+        var sample_rate: u32 = 0;
+        var block_align: u16 = 0;
+        var data_size: u32 = 0;
+
+        while (true) {
+            const id = try reader.readBytesNoEof(4);
+            const size = try reader.readInt(u32, .little);
+
+            if (std.mem.eql(u8, &id, "fmt ")) {
+                if (size < 16) return Error.invalid_header;
+
+                var format = try reader.readInt(u16, .little);
+                channels = try reader.readInt(u16, .little);
+                sample_rate = try reader.readInt(u32, .little);
+                _ = try reader.readInt(u32, .little); // Byte rate
+                block_align = try reader.readInt(u16, .little);
+                const bits = try reader.readInt(u16, .little);
+                var consumed: u32 = 16;
+
+                // The actual format is the first two bytes of the sub format GUID
+                if (format == format_extensible and size >= 26) {
+                    try reader.skipBytes(8, .{}); // Extension size, valid bits and channel mask
+                    format = try reader.readInt(u16, .little);
+                    consumed += 10;
+                }
+
+                try reader.skipBytes(size - consumed + (size & 1), .{});
+
+                encoding = switch (format) {
+                    format_pcm => switch (bits) {
+                        8 => .unsigned8,
+                        16 => .signed16,
+                        24 => .signed24,
+                        32 => .signed32,
+                        else => return Error.unsupported_format,
+                    },
+                    format_ieee_float => switch (bits) {
+                        32 => .float32,
+                        else => return Error.unsupported_format,
+                    },
+                    else => return Error.unsupported_format,
+                };
+            } else if (std.mem.eql(u8, &id, "data")) {
+                data_size = size;
+                break;
+            } else {
+                try reader.skipBytes(size + (size & 1), .{});
+            }
+        }
+
+        if (encoding == null or channels == 0 or block_align == 0 or block_align > max_block_align) {
+            return Error.unsupported_format;
+        }
+
+        return Reader{
+            .file = file,
+            .buffered = buffered,
+            .encoding = encoding.?,
+            .channels = channels,
+            .sample_rate = sample_rate,
+            .block_align = block_align,
+            .frames_left = data_size / block_align,
+        };
+    }
+
+    pub fn close(self: *Reader) void {
+        self.file.close();
+        self.* = undefined;
+    }
+
+    /// Read interleaved stereo samples into `out`, returns the number of samples written.
+    /// Mono files are duplicated to both channels, additional channels are ignored.
+    pub fn read(self: *Reader, out: []f32) !usize {
+        const reader = self.buffered.reader();
+        const frames = @min(out.len / Config.channel_count, self.frames_left);
+        const sample_size = self.block_align / self.channels;
+
+        var block: [max_block_align]u8 = undefined;
+
+        for (0..frames) |i| {
+            try reader.readNoEof(block[0..self.block_align]);
+
+            const left = self.decode(block[0..sample_size]);
+            const right = if (self.channels > 1) self.decode(block[sample_size .. 2 * sample_size]) else left;
+
+            out[i * Config.channel_count + 0] = left;
+            out[i * Config.channel_count + 1] = right;
+        }
+
+        self.frames_left -= frames;
+
+        return frames * Config.channel_count;
+    }
+
+    fn decode(self: *const Reader, bytes: []const u8) f32 {
+        return switch (self.encoding) {
+            .unsigned8 => (@as(f32, @floatFromInt(bytes[0])) - 128.0) / 128.0,
+            .signed16 => @as(f32, @floatFromInt(std.mem.readInt(i16, bytes[0..2], .little))) / 32768.0,
+            .signed24 => @as(f32, @floatFromInt(std.mem.readInt(i24, bytes[0..3], .little))) / 8388608.0,
+            .signed32 => @as(f32, @floatFromInt(std.mem.readInt(i32, bytes[0..4], .little))) / 2147483648.0,
+            .float32 => @bitCast(std.mem.readInt(u32, bytes[0..4], .little)),
+        };
+    }
+};
+
+/// A WAVE file with one format chunk and `data_size` declared in its data chunk
+fn testFile(dir: std.fs.Dir, format: u16, channels: u16, sample_rate: u32, bits: u16, data: []const u8, data_size: u32) !std.fs.File {
+    const file = try dir.createFile("test.wav", .{ .read = true });
+    errdefer file.close();
+
+    const writer = file.writer();
+    const block_align = channels * bits / 8;
+
+    try writer.writeAll("RIFF");
+    try writer.writeInt(u32, @intCast(36 + data.len), .little);
+    try writer.writeAll("WAVE");
+
+    try writer.writeAll("fmt ");
+    try writer.writeInt(u32, 16, .little);
+    try writer.writeInt(u16, format, .little);
+    try writer.writeInt(u16, channels, .little);
+    try writer.writeInt(u32, sample_rate, .little);
+    try writer.writeInt(u32, sample_rate * block_align, .little);
+    try writer.writeInt(u16, block_align, .little);
+    try writer.writeInt(u16, bits, .little);
+
+    try writer.writeAll("data");
+    try writer.writeInt(u32, data_size, .little);
+    try writer.writeAll(data);
+
+    try file.seekTo(0);
+    return file;
+}
+
+test "reads 16 bit pcm" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    const samples = [_]i16{ 0, 16384, -32768, 32767 };
+    const data = std.mem.sliceAsBytes(&samples);
+
+    var reader = try Reader.fromFile(try testFile(tmp.dir, format_pcm, 2, 48000, 16, data, @intCast(data.len)));
+    defer reader.close();
+
+    try std.testing.expectEqual(48000, reader.sample_rate);
+    try std.testing.expectEqual(2, reader.frames_left);
+
+    var out: [8]f32 = undefined;
+    const len = try reader.read(&out);
+    try std.testing.expectEqualSlices(f32, &.{ 0.0, 0.5, -1.0, 32767.0 / 32768.0 }, out[0..len]);
+    try std.testing.expectEqual(0, try reader.read(&out));
+}
+
+test "reads mono float to both channels" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    const samples = [_]f32{ 0.25, -0.5, 1.0 };
+    const data = std.mem.sliceAsBytes(&samples);
+
+    var reader = try Reader.fromFile(try testFile(tmp.dir, format_ieee_float, 1, Config.sample_rate, 32, data, @intCast(data.len)));
+    defer reader.close();
+
+    // Fewer frames than fit, then the rest
+    var out: [4]f32 = undefined;
+    var len = try reader.read(&out);
+    try std.testing.expectEqualSlices(f32, &.{ 0.25, 0.25, -0.5, -0.5 }, out[0..len]);
+    len = try reader.read(&out);
+    try std.testing.expectEqualSlices(f32, &.{ 1.0, 1.0 }, out[0..len]);
+}
+
+test "rejects unsupported formats" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    const data = [_]u8{0} ** 8;
+
+    // ADPCM
+    const adpcm = try testFile(tmp.dir, 0x0002, 2, Config.sample_rate, 16, &data, data.len);
+    defer adpcm.close();
+    try std.testing.expectError(Error.unsupported_format, Reader.fromFile(adpcm));
+
+    // 64 bit float
+    const double = try testFile(tmp.dir, format_ieee_float, 1, Config.sample_rate, 64, &data, data.len);
+    defer double.close();
+    try std.testing.expectError(Error.unsupported_format, Reader.fromFile(double));
+}
+
+test "fails on truncated files" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    const samples = [_]i16{ 1, 2, 3, 4 };
+    const data = std.mem.sliceAsBytes(&samples);
+
+    // The data chunk declares more frames than the file holds
+    var reader = try Reader.fromFile(try testFile(tmp.dir, format_pcm, 2, Config.sample_rate, 16, data, @intCast(4 * data.len)));
+    defer reader.close();
+
+    var out: [32]f32 = undefined;
+    try std.testing.expectError(error.EndOfStream, reader.read(&out));
+
+    // The header ends inside the format chunk
+    const header = try tmp.dir.createFile("header.wav", .{ .read = true });
+    defer header.close();
+    try header.writeAll("RIFF\x24\x00\x00\x00WAVEfmt \x10\x00\x00\x00\x01\x00");
+    try header.seekTo(0);
+    try std.testing.expectError(error.EndOfStream, Reader.fromFile(header));
+}
@@ -1,7 +1,9 @@
 const std = @import("std");
 
-const RingBuffer = @import("../buffer.zig").RingBuffer;
+const RingBuffer = @import("../buffer.zig").SpscRingBuffer;
 const Config = @import("../Config.zig");
+const trace = @import("../../trace.zig");
+const sched = @import("../../sched.zig");
 
 const Allocator = std.mem.Allocator;
 const L = std.unicode.utf8ToUtf16LeStringLiteral;
@@ -256,8 +258,6 @@ pub const WindowsImpl = struct {
     }
 
     pub fn sample(self: *WindowsImpl) []const f32 {
-        self.mutex.lock();
-        defer self.mutex.unlock();
         return self.ring_buffer.receive();
     }
 
@@ -269,6 +269,9 @@ pub const WindowsImpl = struct {
         var frames: u32 = 0;
         var flags: u64 = 0;
 
+        trace.nameThread("wasapi capture");
+        sched.apply(.capture);
+
         while (self.running) {
             if (win.WaitForSingleObject(self.sample_ready_event, 100) != win.WAIT_OBJECT_0) {
                 continue;
@@ -283,12 +286,12 @@ pub const WindowsImpl = struct {
                 null,
             ) == win.S_OK) {
                 defer _ = release_fn(self.capture_client, frames);
+                const z = trace.zone("wasapi read");
+                defer z.end();
 
                 const data_size = frames * Config.channel_count;
 
-                self.mutex.lock();
                 self.ring_buffer.send(p_data[0..data_size]);
-                self.mutex.unlock();
             }
         }
     }
@@ -0,0 +1,163 @@
+//!
+//! Microbenchmark of `AudioAnalyzer.analyze`, run with `bob bench`. Compares
+//! analyzer state in one aligned arena against separate allocations.
+//!
+
+const std = @import("std");
+const builtin = @import("builtin");
+const AudioAnalyzer = @import("audio/AudioAnalyzer.zig");
+const Config = @import("audio/Config.zig");
+const Flags = @import("flags.zig").Flags;
+const signal = @import("audio/generator/signal.zig");
+
+const usage =
+    \\usage: bob bench [options]
+    \\
+    \\options:
+    \\  --iterations <n>       analyze calls measured per layout (default 2000)
+    \\  --hop <frames>         frames per analyze call (default 1024)
+    \\
+;
+
+const Options = struct {
+    iterations: usize = 2000,
+    hop: usize = 1024,
+
+    fn parse(args: []const [:0]u8) !Options {
+        var options = Options{};
+        var i: usize = 0;
+
+        while (i < args.len) : (i += 2) {
+            if (i + 1 >= args.len) {
+                return error.invalid_arguments;
+            }
+
+            const option = args[i];
+            const value = args[i + 1];
+
+            if (std.mem.eql(u8, option, "--iterations")) {
+                options.iterations = try std.fmt.parseInt(usize, value, 10);
+            } else if (std.mem.eql(u8, option, "--hop")) {
+                options.hop = try std.fmt.parseInt(usize, value, 10);
+            } else {
+                return error.invalid_arguments;
+            }
+        }
+
+        if (options.hop == 0 or options.hop > Config.windowSize() / Config.channel_count) {
+            return error.invalid_arguments;
+        }
+
+        return options;
+    }
+};
+
+/// Hardware counters for the calling thread, zero where unsupported
+const Counters = struct {
+    const Event = enum { cache_misses, dtlb_misses };
+
+    fds: std.EnumArray(Event, ?std.posix.fd_t),
+
+    fn open() Counters {
+        var self = Counters{ .fds = std.EnumArray(Event, ?std.posix.fd_t).initFill(null) };
+        if (builtin.os.tag != .linux) {
+            return self;
+        }
+
+        const linux = std.os.linux;
+        const cache = linux.PERF.COUNT.HW.CACHE;
+
+        for (std.enums.values(Event)) |event| {
+            var attr = linux.perf_event_attr{
+                .type = switch (event) {
+                    .cache_misses => linux.PERF.TYPE.HARDWARE,
+                    .dtlb_misses => linux.PERF.TYPE.HW_CACHE,
+                },
+                .config = switch (event) {
+                    .cache_misses => @intFromEnum(linux.PERF.COUNT.HW.CACHE_MISSES),
+                    .dtlb_misses => @intFromEnum(cache.DTLB) |
+                        @as(u64, @intFromEnum(cache.OP.READ)) << 8 |
+                        @as(u64, @intFromEnum(cache.RESULT.MISS)) << 16,
+                },
+                .flags = .{ .exclude_kernel = true, .exclude_hv = true },
+            };
+
+            self.fds.set(event, std.posix.perf_event_open(&attr, 0, -1, -1, 0) catch |e| blk: {
+                std.log.warn("{s} counter unavailable: {s}", .{ @tagName(event), @errorName(e) });
+                break :blk null;
+            });
+        }
+
+        return self;
+    }
+
+    fn close(self: *Counters) void {
+        for (self.fds.values) |fd| {
+            if (fd) |f| std.posix.close(f);
+        }
+    }
+
+    fn read(self: *const Counters) std.EnumArray(Event, u64) {
+        var values = std.EnumArray(Event, u64).initFill(0);
+        for (std.enums.values(Event)) |event| {
+            const fd = self.fds.get(event) orelse continue;
+            var value: u64 = 0;
+            _ = std.posix.read(fd, std.mem.asBytes(&value)) catch continue;
+            values.set(event, value);
+        }
+        return values;
+    }
+};
+
+/// Entry point for `bob bench`, `args` excludes the program name and subcommand
+pub fn run(args: []const [:0]u8, allocator: std.mem.Allocator) !void {
+    const options = Options.parse(args) catch |e| {
+        std.debug.print(usage, .{});
+        return e;
+    };
+
+    const input = try allocator.alloc(f32, options.hop * Config.channel_count);
+    defer allocator.free(input);
+
+    var generator = signal.Generator.init(.{ .chord = .{} }, Config.sample_rate);
+    generator.render(input);
+
+    var counters = Counters.open();
+    defer counters.close();
+
+    const stdout = std.io.getStdOut().writer();
+    try stdout.print("{s: <10} {s: >12} {s: >14} {s: >14}\n", .{ "layout", "ns/call", "cache-miss/call", "dtlb-miss/call" });
+
+    for ([_]bool{ false, true }) |scattered| {
+        var analyzer = try AudioAnalyzer.init(allocator);
+        defer analyzer.deinit(allocator);
+
+        // Workers would run jobs outside the counted thread
+        analyzer.scattered = scattered;
+        analyzer.worker_count = 0;
+        try analyzer.configure(Flags.all(), allocator);
+
+        // Warm up caches and smoothing state
+        for (0..options.iterations / 10 + 1) |_| {
+            analyzer.analyze(input);
+        }
+
+        const before = counters.read();
+        var timer = try std.time.Timer.start();
+
+        for (0..options.iterations) |_| {
+            analyzer.analyze(input);
+        }
+
+        const elapsed = timer.read();
+        const after = counters.read();
+        const n: f64 = @floatFromInt(options.iterations);
+
+        try stdout.print("{s: <10} {d: >12.0} {d: >14.1} {d: >14.1}\n", .{
+            if (scattered) "scattered" else "arena",
+            @as(f64, @floatFromInt(elapsed)) / n,
+            @as(f64, @floatFromInt(after.get(.cache_misses) - before.get(.cache_misses))) / n,
+            @as(f64, @floatFromInt(after.get(.dtlb_misses) - before.get(.dtlb_misses))) / n,
+        });
+    }
+}
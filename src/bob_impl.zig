@@ -3,6 +3,12 @@ const bob = @import("bob_api.zig");
 const glfw = @import("graphics/glfw.zig");
 const Context = @import("Context.zig");
 const GuiState = @import("GuiState.zig");
+const Chroma = @import("audio/Chroma.zig");
+const AudioAnalyzer = @import("audio/AudioAnalyzer.zig");
+const AudioSplixer = @import("audio/AudioSplixer.zig");
+const WindowFunction = @import("audio/fft.zig").WindowFunction;
+const Filterbank = @import("audio/Filterbank.zig");
+const History = @import("History.zig");
 
 fn checkSignature(comptime name: []const u8) void {
     const t1 = @TypeOf(@field(bob.api, name));
@@ -15,6 +21,9 @@ fn checkSignature(comptime name: []const u8) void {
     }
 }
 
+/// Returned for analyses the visualizer did not enable
+const empty_buffer = bob.bob_float_buffer{ .ptr = null, .size = 0 };
+
 const api_fn_names: []const []const u8 = &.{
     "get_window_size",
     "get_time_data",
@@ -40,6 +49,15 @@ const api_fn_names: []const []const u8 = &.{
     "set_chromagram_c3",
     "set_chromagram_num_octaves",
     "set_chromagram_num_partials",
+    "get_quality_tier",
+    "get_snapshot",
+    "poll_events",
+    "get_timed_buffer",
+    "request_spectrum",
+    "get_spectrum",
+    "get_band_data",
+    "request_history",
+    "get_history",
 };
 
 comptime {
@@ -65,9 +83,10 @@ pub fn get_time_data(context: ?*anyopaque, channel: c_int) callconv(.C) bob.bob_
     const ctx: *const Context = @ptrCast(@alignCast(context.?));
 
     const data = switch (channel) {
-        bob.BOB_MONO_CHANNEL => ctx.analyzer.splixer.getCenter(),
+        bob.BOB_MONO_CHANNEL, bob.BOB_MID_CHANNEL => ctx.analyzer.splixer.getCenter(),
         bob.BOB_LEFT_CHANNEL => ctx.analyzer.splixer.getLeft(),
         bob.BOB_RIGHT_CHANNEL => ctx.analyzer.splixer.getRight(),
+        bob.BOB_SIDE_CHANNEL => ctx.analyzer.splixer.getSide(),
         else => @panic("API function called with invalid BOB_*_CHANNEL"),
     };
 
@@ -80,16 +99,12 @@ pub fn get_time_data(context: ?*anyopaque, channel: c_int) callconv(.C) bob.bob_
 }
 
 pub fn get_frequency_data(context: ?*anyopaque, channel: c_int) callconv(.C) bob.bob_float_buffer {
-    // _ = .{ context, channel };
-    // const buffer: bob.bob_float_buffer = std.mem.zeroes(bob.bob_float_buffer);
-    const ctx: *const Context = @ptrCast(@alignCast(context.?));
+    const ctx: *Context = @ptrCast(@alignCast(context.?));
 
-    const data = switch (channel) {
-        bob.BOB_MONO_CHANNEL => ctx.analyzer.spectral_analyzer_center.read(),
-        bob.BOB_LEFT_CHANNEL => ctx.analyzer.spectral_analyzer_left.read(),
-        bob.BOB_RIGHT_CHANNEL => ctx.analyzer.spectral_analyzer_right.read(),
-        else => @panic("Bad API call"),
-    };
+    const split = splitChannel(channel) orelse @panic("Bad API call");
+    const fft = ctx.analyzer.builtinSpectrum(split) orelse return empty_buffer;
+    ctx.analyzer.require(AudioAnalyzer.spectrumJob(split));
+    const data = fft.read();
 
     const buffer: bob.bob_float_buffer = .{
         .ptr = @ptrCast(data.ptr),
@@ -99,27 +114,37 @@ pub fn get_frequency_data(context: ?*anyopaque, channel: c_int) callconv(.C) bob
 }
 
 pub fn get_chromagram(context: ?*anyopaque, buf: [*c]f32, channel: c_int) callconv(.C) void {
-    const ctx: *const Context = @ptrCast(@alignCast(context.?));
+    const ctx: *Context = @ptrCast(@alignCast(context.?));
 
-    const data = switch (channel) {
-        bob.BOB_MONO_CHANNEL => &ctx.analyzer.chroma_center.chroma,
-        bob.BOB_LEFT_CHANNEL => &ctx.analyzer.chroma_left.chroma,
-        bob.BOB_RIGHT_CHANNEL => &ctx.analyzer.chroma_right.chroma,
+    const job: AudioAnalyzer.Job = switch (channel) {
+        bob.BOB_MONO_CHANNEL, bob.BOB_MID_CHANNEL => .chroma_center,
+        bob.BOB_LEFT_CHANNEL => .chroma_left,
+        bob.BOB_RIGHT_CHANNEL => .chroma_right,
         else => @panic("Bad API call"),
     };
+    const chroma: *?Chroma = switch (job) {
+        .chroma_left => &ctx.analyzer.chroma_left,
+        .chroma_right => &ctx.analyzer.chroma_right,
+        else => &ctx.analyzer.chroma_center,
+    };
 
     var buf_slice: []f32 = undefined;
     buf_slice.ptr = @ptrCast(buf);
     buf_slice.len = 12;
 
-    @memcpy(buf_slice, data);
+    if (chroma.*) |*c| {
+        ctx.analyzer.require(job);
+        @memcpy(buf_slice, &c.chroma);
+    } else {
+        @memset(buf_slice, 0.0);
+    }
 }
 
 pub fn get_pulse_data(context: ?*anyopaque, channel: c_int) callconv(.C) bob.bob_float_buffer {
     const ctx: *const Context = @ptrCast(@alignCast(context.?));
 
     const beat = switch (channel) {
-        bob.BOB_MONO_CHANNEL => &ctx.analyzer.beat_center,
+        bob.BOB_MONO_CHANNEL, bob.BOB_MID_CHANNEL => if (ctx.analyzer.beat_center) |*b| b else return empty_buffer,
         else => @panic("Bad API call"),
     };
 
@@ -135,7 +160,7 @@ pub fn get_pulse_graph(context: ?*anyopaque, channel: c_int) callconv(.C) bob.bo
     const ctx: *const Context = @ptrCast(@alignCast(context.?));
 
     const beat = switch (channel) {
-        bob.BOB_MONO_CHANNEL => &ctx.analyzer.beat_center,
+        bob.BOB_MONO_CHANNEL, bob.BOB_MID_CHANNEL => if (ctx.analyzer.beat_center) |*b| b else return empty_buffer,
         else => @panic("Bad API call"),
     };
 
@@ -151,7 +176,7 @@ pub fn set_pulse_params(context: ?*anyopaque, channel: c_int, C: f32, Vl: f32) c
     const ctx: *Context = @ptrCast(@alignCast(context.?));
 
     const beat = switch (channel) {
-        bob.BOB_MONO_CHANNEL => &ctx.analyzer.beat_center,
+        bob.BOB_MONO_CHANNEL, bob.BOB_MID_CHANNEL => if (ctx.analyzer.beat_center) |*b| b else return,
         else => @panic("Bad API call"),
     };
 
@@ -163,7 +188,7 @@ pub fn get_tempo(context: ?*anyopaque, channel: c_int) callconv(.C) f32 {
     const ctx: *const Context = @ptrCast(@alignCast(context.?));
 
     const tempo = switch (channel) {
-        bob.BOB_MONO_CHANNEL => &ctx.analyzer.tempo_center,
+        bob.BOB_MONO_CHANNEL, bob.BOB_MID_CHANNEL => if (ctx.analyzer.tempo_center) |*t| t else return 0.0,
         else => @panic("Bad API call"),
     };
 
@@ -174,7 +199,7 @@ pub fn get_tempo_graph(context: ?*anyopaque, channel: c_int) callconv(.C) bob.bo
     const ctx: *const Context = @ptrCast(@alignCast(context.?));
 
     const tempo = switch (channel) {
-        bob.BOB_MONO_CHANNEL => &ctx.analyzer.tempo_center,
+        bob.BOB_MONO_CHANNEL, bob.BOB_MID_CHANNEL => if (ctx.analyzer.tempo_center) |*t| t else return empty_buffer,
         else => @panic("Bad API call"),
     };
 
@@ -190,7 +215,7 @@ pub fn in_break(context: ?*anyopaque, channel: c_int) callconv(.C) c_int {
     const ctx: *Context = @ptrCast(@alignCast(context.?));
 
     const flag = switch (channel) {
-        bob.BOB_MONO_CHANNEL => &ctx.analyzer.breaks_center.visualizer_flag,
+        bob.BOB_MONO_CHANNEL, bob.BOB_MID_CHANNEL => &ctx.analyzer.breaks_center.visualizer_flag,
         bob.BOB_LEFT_CHANNEL => &ctx.analyzer.breaks_left.visualizer_flag,
         bob.BOB_RIGHT_CHANNEL => &ctx.analyzer.breaks_right.visualizer_flag,
         else => @panic("Bad API call"),
@@ -205,9 +230,18 @@ pub fn get_key(context: ?*anyopaque, channel: c_int) callconv(.C) bob.bob_key {
     const ctx: *Context = @ptrCast(@alignCast(context.?));
 
     const result = switch (channel) {
-        bob.BOB_MONO_CHANNEL => &ctx.analyzer.key_center.result,
-        bob.BOB_LEFT_CHANNEL => &ctx.analyzer.key_left.result,
-        bob.BOB_RIGHT_CHANNEL => &ctx.analyzer.key_right.result,
+        bob.BOB_MONO_CHANNEL, bob.BOB_MID_CHANNEL => blk: {
+            ctx.analyzer.require(.key_center);
+            break :blk &ctx.analyzer.key_center.result;
+        },
+        bob.BOB_LEFT_CHANNEL => blk: {
+            ctx.analyzer.require(.key_left);
+            break :blk &ctx.analyzer.key_left.result;
+        },
+        bob.BOB_RIGHT_CHANNEL => blk: {
+            ctx.analyzer.require(.key_right);
+            break :blk &ctx.analyzer.key_right.result;
+        },
         else => @panic("Bad API call"),
     };
 
@@ -224,7 +258,11 @@ pub fn get_mood(context: ?*anyopaque, channel: c_int) callconv(.C) c_int {
     const ctx: *Context = @ptrCast(@alignCast(context.?));
 
     const mood = switch (channel) {
-        bob.BOB_MONO_CHANNEL => ctx.analyzer.mood_center.read(),
+        bob.BOB_MONO_CHANNEL, bob.BOB_MID_CHANNEL => blk: {
+            if (ctx.analyzer.mood_center == null) return 0;
+            ctx.analyzer.require(.mood_center);
+            break :blk ctx.analyzer.mood_center.?.read();
+        },
         else => @panic("Bad API call"),
     };
 
@@ -371,23 +409,187 @@ pub fn get_ui_colorpicker_value(context: ?*anyopaque, handle: c_int, color: [*c]
 }
 pub fn set_chromagram_c3(context: ?*anyopaque, pitch: f32) callconv(.C) void {
     const ctx: *Context = @alignCast(@ptrCast(context.?));
-    ctx.analyzer.chroma_left.c3 = pitch;
-    ctx.analyzer.chroma_right.c3 = pitch;
-    ctx.analyzer.chroma_center.c3 = pitch;
+    for ([_]*?Chroma{ &ctx.analyzer.chroma_left, &ctx.analyzer.chroma_right, &ctx.analyzer.chroma_center }) |chroma| {
+        if (chroma.*) |*c| c.c3 = pitch;
+    }
 }
 
 pub fn set_chromagram_num_octaves(context: ?*anyopaque, num: usize) callconv(.C) void {
     const ctx: *Context = @alignCast(@ptrCast(context.?));
-    ctx.analyzer.chroma_left.num_octaves = num;
-    ctx.analyzer.chroma_right.num_octaves = num;
-    ctx.analyzer.chroma_center.num_octaves = num;
+    for ([_]*?Chroma{ &ctx.analyzer.chroma_left, &ctx.analyzer.chroma_right, &ctx.analyzer.chroma_center }) |chroma| {
+        if (chroma.*) |*c| c.num_octaves = num;
+    }
 }
 
 pub fn set_chromagram_num_partials(context: ?*anyopaque, num: usize) callconv(.C) void {
     const ctx: *Context = @alignCast(@ptrCast(context.?));
-    ctx.analyzer.chroma_left.num_partials = num;
-    ctx.analyzer.chroma_right.num_partials = num;
-    ctx.analyzer.chroma_center.num_partials = num;
+    for ([_]*?Chroma{ &ctx.analyzer.chroma_left, &ctx.analyzer.chroma_right, &ctx.analyzer.chroma_center }) |chroma| {
+        if (chroma.*) |*c| c.num_partials = num;
+    }
+}
+
+pub fn get_quality_tier(context: ?*anyopaque) callconv(.C) c_int {
+    const ctx: *const Context = @ptrCast(@alignCast(context.?));
+    return @intFromEnum(ctx.analyzer.quality);
+}
+
+pub fn get_snapshot(context: ?*anyopaque) callconv(.C) [*c]const bob.bob_snapshot {
+    const ctx: *Context = @ptrCast(@alignCast(context.?));
+    return ctx.snapshot.read();
+}
+
+pub fn poll_events(context: ?*anyopaque, buf: [*c]bob.bob_event, max: c_int) callconv(.C) c_int {
+    const ctx: *Context = @ptrCast(@alignCast(context.?));
+    if (max <= 0) {
+        return 0;
+    }
+
+    const events: []bob.bob_event = buf[0..@intCast(max)];
+    return @intCast(ctx.events.poll(events));
+}
+
+pub fn get_timed_buffer(context: ?*anyopaque, kind: c_int, channel: c_int) callconv(.C) bob.bob_timed_buffer {
+    const ctx: *Context = @ptrCast(@alignCast(context.?));
+
+    const buffer = switch (kind) {
+        bob.BOB_BUFFER_TIME_DATA => get_time_data(context, channel),
+        bob.BOB_BUFFER_FREQUENCY_DATA => get_frequency_data(context, channel),
+        bob.BOB_BUFFER_PULSE_DATA => get_pulse_data(context, channel),
+        bob.BOB_BUFFER_PULSE_GRAPH => get_pulse_graph(context, channel),
+        bob.BOB_BUFFER_TEMPO_GRAPH => get_tempo_graph(context, channel),
+        else => @panic("Bad API call"),
+    };
+
+    // The getters above rejected invalid channels
+    const stamp = switch (kind) {
+        bob.BOB_BUFFER_TIME_DATA => ctx.analyzer.frame,
+        bob.BOB_BUFFER_FREQUENCY_DATA => ctx.analyzer.stamps.get(switch (channel) {
+            bob.BOB_LEFT_CHANNEL => .spectrum_left,
+            bob.BOB_RIGHT_CHANNEL => .spectrum_right,
+            bob.BOB_SIDE_CHANNEL => .spectrum_side,
+            else => .spectrum_center,
+        }),
+        bob.BOB_BUFFER_PULSE_DATA, bob.BOB_BUFFER_PULSE_GRAPH => ctx.analyzer.stamps.get(.beat_center),
+        // Disabled tempo returned an empty buffer above
+        else => if (ctx.analyzer.tempo_center) |*tempo| tempo.get_graph_stamp() else AudioAnalyzer.Stamp{},
+    };
+
+    return .{
+        .version = bob.BOB_TIMED_BUFFER_VERSION,
+        .ptr = buffer.ptr,
+        .size = buffer.size,
+        .sequence = stamp.sequence,
+        .timestamp = stamp.timestamp,
+        .samples = stamp.samples,
+    };
+}
+
+pub fn request_spectrum(context: ?*anyopaque, request: [*c]const bob.bob_spectrum_request) callconv(.C) c_int {
+    const ctx: *Context = @ptrCast(@alignCast(context.?));
+    const r = request.?.*;
+
+    const channel = splitChannel(r.channel) orelse return -1;
+    if (r.size_log2 < 0 or r.size_log2 > 63 or r.padding_log2 < 0 or r.padding_log2 > 63 or r.hop < 0) {
+        return -1;
+    }
+    if (r.window < 0 or r.window >= std.enums.values(WindowFunction).len) {
+        return -1;
+    }
+
+    const handle = ctx.analyzer.requestSpectrum(.{
+        .channel = channel,
+        .size_log2 = @intCast(r.size_log2),
+        .padding_log2 = @intCast(r.padding_log2),
+        .window = @enumFromInt(r.window),
+        .hop = @intCast(r.hop),
+        .smoothing = r.smoothing,
+    }, ctx.allocator) catch return -1;
+
+    return @intCast(handle);
+}
+
+pub fn get_spectrum(context: ?*anyopaque, handle: c_int) callconv(.C) bob.bob_timed_buffer {
+    const ctx: *Context = @ptrCast(@alignCast(context.?));
+    if (handle < 0 or @as(usize, @intCast(handle)) >= ctx.analyzer.requested.items.len) {
+        @panic("Bad API call");
+    }
+
+    const spectrum = ctx.analyzer.readSpectrum(@intCast(handle));
+
+    return .{
+        .version = bob.BOB_TIMED_BUFFER_VERSION,
+        .ptr = spectrum.data.ptr,
+        .size = spectrum.data.len,
+        .sequence = spectrum.stamp.sequence,
+        .timestamp = spectrum.stamp.timestamp,
+        .samples = spectrum.stamp.samples,
+    };
+}
+
+pub fn get_band_data(context: ?*anyopaque, channel: c_int, n_bands: c_int, scale: c_int) callconv(.C) bob.bob_timed_buffer {
+    const ctx: *Context = @ptrCast(@alignCast(context.?));
+    var buffer = std.mem.zeroes(bob.bob_timed_buffer);
+    buffer.version = bob.BOB_TIMED_BUFFER_VERSION;
+
+    const split = splitChannel(channel) orelse @panic("API function called with invalid BOB_*_CHANNEL");
+    if (n_bands < 1 or n_bands > Filterbank.max_bands or scale < 0 or scale >= std.enums.values(Filterbank.Scale).len) {
+        return buffer;
+    }
+
+    const bands = ctx.bands.read(&ctx.analyzer, split, @intCast(n_bands), @enumFromInt(scale), ctx.allocator) catch return buffer;
+    if (bands) |b| {
+        buffer.ptr = b.data.ptr;
+        buffer.size = b.data.len;
+        buffer.sequence = b.stamp.sequence;
+        buffer.timestamp = b.stamp.timestamp;
+        buffer.samples = b.stamp.samples;
+    }
+    return buffer;
+}
+
+pub fn request_history(context: ?*anyopaque, kind: c_int, channel: c_int, rows: c_int) callconv(.C) c_int {
+    const ctx: *Context = @ptrCast(@alignCast(context.?));
+
+    const split = splitChannel(channel) orelse return -1;
+    if (kind < 0 or kind >= std.enums.values(History.Kind).len or rows < 0) {
+        return -1;
+    }
+
+    ctx.history.request(&ctx.analyzer, @enumFromInt(kind), split, @intCast(rows), ctx.allocator) catch return -1;
+    return 0;
+}
+
+pub fn get_history(context: ?*anyopaque, kind: c_int, channel: c_int) callconv(.C) bob.bob_history {
+    const ctx: *const Context = @ptrCast(@alignCast(context.?));
+    var history = std.mem.zeroes(bob.bob_history);
+
+    const split = splitChannel(channel) orelse @panic("API function called with invalid BOB_*_CHANNEL");
+    if (kind < 0 or kind >= std.enums.values(History.Kind).len) {
+        @panic("Bad API call");
+    }
+
+    if (ctx.history.get(@enumFromInt(kind), split)) |ring| {
+        history.ptr = ring.data.ptr;
+        history.stride = ring.stride;
+        history.size = ring.size;
+        history.rows = ring.rows;
+        history.count = ring.count;
+        history.head = ring.head;
+        history.sequence = ring.stamp.sequence;
+        history.timestamp = ring.stamp.timestamp;
+    }
+    return history;
+}
+
+/// The split channel a BOB_*_CHANNEL reads, mid is the mono signal
+fn splitChannel(channel: c_int) ?AudioSplixer.Channel {
+    return switch (channel) {
+        bob.BOB_MONO_CHANNEL, bob.BOB_MID_CHANNEL => .center,
+        bob.BOB_LEFT_CHANNEL => .left,
+        bob.BOB_RIGHT_CHANNEL => .right,
+        bob.BOB_SIDE_CHANNEL => .side,
+        else => null,
+    };
 }
 
 pub fn fill(context: ?*anyopaque, visualizer_api_ptr: *@TypeOf(bob.api)) void {
@@ -22,6 +22,8 @@ pub const Flags = struct {
     key_stereo: bool = false,
     mood_mono: bool = false,
     mood_stereo: bool = false,
+    time_side: bool = false,
+    frequency_side: bool = false,
 
     pub fn init(flags: c_int) Flags {
         return Flags{
@@ -41,9 +43,20 @@ pub const Flags = struct {
             .key_stereo = flags & bob.BOB_AUDIO_KEY_STEREO != 0,
             .mood_mono = flags & bob.BOB_AUDIO_MOOD_MONO != 0,
             .mood_stereo = flags & bob.BOB_AUDIO_MOOD_STEREO != 0,
+            .time_side = flags & bob.BOB_AUDIO_TIME_DOMAIN_SIDE != 0,
+            .frequency_side = flags & bob.BOB_AUDIO_FREQUENCY_DOMAIN_SIDE != 0,
         };
     }
 
+    /// Every analysis, mono, stereo and side
+    pub fn all() Flags {
+        var flags = Flags{};
+        inline for (std.meta.fields(Flags)) |field| {
+            @field(flags, field.name) = true;
+        }
+        return flags;
+    }
+
     pub fn log(self: Flags) void {
         std.log.info("visualizer audio flags:", .{});
         inline for (std.meta.fields(Flags)) |field| {
@@ -7,6 +7,10 @@ const glfw = @import("graphics/glfw.zig");
 const gl = @import("graphics/glad.zig");
 const Context = @import("Context.zig");
 const Flags = @import("flags.zig").Flags;
+const trace = @import("trace.zig");
+const sched = @import("sched.zig");
+const CountingAllocator = @import("CountingAllocator.zig");
+const build_options = @import("build_options");
 
 const audio_producer_enumerator = @import("producers/enumerator.zig");
 const Window = @import("graphics/window.zig").Window(8);
@@ -22,6 +26,9 @@ fn resizeCallback(x: i32, y: i32, userdata: ?*anyopaque) void {
 
 var hide_ui: bool = false;
 
+/// Where a recording started with `--trace` or key T is written
+var trace_path: []const u8 = "bob-trace.json";
+
 /// Userdata is window
 fn keyboardCallback(key: i32, _: i32, action: i32, _: i32, userdata: ?*anyopaque) void {
     var window: *Window = @ptrCast(@alignCast(userdata.?)); // This is ok
@@ -45,6 +52,19 @@ fn keyboardCallback(key: i32, _: i32, action: i32, _: i32, userdata: ?*anyopaque
                 }
             }
         },
+        glfw.GLFW_KEY_T => {
+            if (action == glfw.GLFW_PRESS) {
+                if (trace.isRecording()) {
+                    trace.save(trace_path) catch |e| {
+                        std.log.err("unable to save trace to {s}: {s}", .{ trace_path, @errorName(e) });
+                    };
+                } else {
+                    trace.start() catch |e| {
+                        std.log.err("unable to start trace: {s}", .{@errorName(e)});
+                    };
+                }
+            }
+        },
         else => {},
     }
 }
@@ -52,7 +72,62 @@ fn keyboardCallback(key: i32, _: i32, action: i32, _: i32, userdata: ?*anyopaque
 pub fn main() !void {
     var gpa = std.heap.GeneralPurposeAllocator(.{}){};
     defer _ = gpa.deinit();
-    const allocator = gpa.allocator();
+
+    var counting = CountingAllocator.init(gpa.allocator());
+    defer {
+        if (build_options.check_allocations) {
+            std.log.info("{d} allocations, {d} in steady state", .{ counting.total.load(.monotonic), counting.violations.load(.monotonic) });
+        }
+    }
+    const allocator = if (build_options.check_allocations) counting.allocator() else gpa.allocator();
+
+    const args = try std.process.argsAlloc(allocator);
+    defer std.process.argsFree(allocator, args);
+
+    if (args.len > 1 and std.mem.eql(u8, args[1], "analyze")) {
+        return @import("offline.zig").run(args[2..], allocator);
+    }
+
+    if (args.len > 1 and std.mem.eql(u8, args[1], "bench")) {
+        return @import("bench.zig").run(args[2..], allocator);
+    }
+
+    var arg: usize = 1;
+    while (arg < args.len) : (arg += 2) {
+        if (arg + 1 >= args.len) {
+            std.log.err("missing value for {s}", .{args[arg]});
+            return error.invalid_arguments;
+        }
+
+        const option = args[arg];
+        const value = args[arg + 1];
+
+        if (std.mem.eql(u8, option, "--trace")) {
+            trace_path = value;
+            try trace.start();
+        } else if (std.mem.eql(u8, option, "--sched")) {
+            // role=settings, for example capture=fifo:70@2
+            const eq = std.mem.indexOfScalar(u8, value, '=') orelse return error.invalid_arguments;
+            const role = std.meta.stringToEnum(sched.Role, value[0..eq]) orelse return error.invalid_arguments;
+            sched.config.set(role, sched.Settings.parse(value[eq + 1 ..]) catch |e| {
+                std.log.err("invalid scheduling settings {s}", .{value});
+                return e;
+            });
+        } else {
+            std.log.err("unknown option {s}", .{option});
+            return error.invalid_arguments;
+        }
+    }
+
+    sched.apply(.render);
+    defer {
+        if (trace.isRecording()) {
+            trace.save(trace_path) catch |e| {
+                std.log.err("unable to save trace to {s}: {s}", .{ trace_path, @errorName(e) });
+            };
+        }
+        trace.deinit();
+    }
 
     // the path to visualizers is currently overridden with the path where buildExample puts them
     var visualizer_list = try @import("VisualizerList.zig").init(allocator, "zig-out/bob");
@@ -79,10 +154,13 @@ pub fn main() !void {
     var current_index: ?usize = null;
     var pid_str = [_]u8{0} ** 32;
 
-    var possible_audio_producers = audio_producer_enumerator.AudioProducerEntry.List.init(gpa.allocator());
-    defer possible_audio_producers.deinit();
+    var audio_producers = audio_producer_enumerator.AudioProducerEntry.List.init(allocator);
+    defer audio_producers.deinit();
+
+    var audio_producer_registry = audio_producer_enumerator.Registry.init(allocator);
+    defer audio_producer_registry.deinit();
 
-    audio_producer_enumerator.enumerate(&possible_audio_producers) catch |e| {
+    audio_producer_registry.start() catch |e| {
         try context.err.setMessage("Unable to list audio sources: {s}", .{@errorName(e)}, allocator);
     };
 
@@ -94,8 +172,19 @@ pub fn main() !void {
     const bob_dir = try std.process.getCwd(&bob_dir_buf);
 
     while (running) {
-        window.update();
-        defer window.swap();
+        const frame_zone = trace.zone("frame");
+        defer frame_zone.end();
+
+        {
+            const z = trace.zone("poll");
+            defer z.end();
+            window.update();
+        }
+        defer {
+            const z = trace.zone("swap");
+            window.swap();
+            z.end();
+        }
         defer running = window.running();
         defer {
             if (context.window_did_resize) {
@@ -109,10 +198,26 @@ pub fn main() !void {
         }
 
         // === Update sate ===
+        context.pollConnect(allocator) catch |e| {
+            std.log.err("Failed to connect: {s}", .{@errorName(e)});
+            try context.err.setMessage("Unable to connect: {s}", .{@errorName(e)}, allocator);
+        };
+
+        _ = audio_producer_registry.read(&audio_producers) catch |e| blk: {
+            try context.err.setMessage("Unable to list audio sources: {s}", .{@errorName(e)}, allocator);
+            break :blk false;
+        };
+
         context.processAudio();
 
         // === Draw begins here ===
-        if (context.visualizer != null and context.capturer != null) {
+        if (context.visualizer != null and context.isConnected()) {
+            const z = trace.zone("visualizer update");
+            defer z.end();
+
+            // Visualizers only read through the API here
+            CountingAllocator.enter();
+            defer CountingAllocator.leave();
             context.visualizer.?.update();
         } else {
             // Much clearer
@@ -121,19 +226,72 @@ pub fn main() !void {
         }
 
         if (!hide_ui) {
+            const ui_zone = trace.zone("ui");
+            defer ui_zone.end();
+
             ui.beginFrame();
 
             // Make the default window a bit bigger. As it is too small with
             // the new font otherwise.
             imgui.SetWindowSize_Vec2Ext(imgui.Vec2{ .x = 600, .y = 300 }, imgui.CondFlags{ .Once = true });
 
-            if (context.capturer) |_| {
+            var disconnect_index: ?usize = null;
+            for (context.mixer.sources.items, 0..) |*source, i| {
+                imgui.PushID_Int(@intCast(i));
+                defer imgui.PopID();
+
                 if (imgui.Button("Disconnect")) {
-                    context.disconnect(allocator) catch |e| {
-                        std.log.err("unable to disconnect: {s}", .{@errorName(e)});
-                    };
+                    disconnect_index = i;
                 }
+                imgui.SameLine();
+                _ = imgui.SliderFloat(&source.name, &source.gain, 0.0, 2.0);
+                if (source.capturer.latency()) |usec| {
+                    var latency_str: [64]u8 = undefined;
+                    imgui.SameLine();
+                    imgui.Text(std.fmt.bufPrintZ(&latency_str, "{d:.1} ms", .{
+                        @as(f32, @floatFromInt(usec)) / std.time.us_per_ms,
+                    }) catch unreachable);
+                }
+            }
+            if (disconnect_index) |i| {
+                context.disconnect(i, allocator) catch |e| {
+                    std.log.err("unable to disconnect: {s}", .{@errorName(e)});
+                };
+            }
+
+            _ = imgui.Checkbox("Lazy analysis", &context.analyzer.lazy);
+            _ = imgui.Checkbox("Silence gate", &context.analyzer.gate.enabled);
+            if (context.analyzer.gate.closed) {
+                imgui.SameLine();
+                imgui.Text("(silent)");
+            }
+            _ = imgui.SliderFloat("Analysis budget (ms)", &context.governor.budget_ms, 0.5, 16.0);
+            var quality_str: [64]u8 = undefined;
+            imgui.Text(std.fmt.bufPrintZ(&quality_str, "Quality: {s} ({d:.2} ms)", .{
+                @tagName(context.analyzer.quality),
+                context.governor.cost_ms,
+            }) catch unreachable);
+
+            const applied = sched.applied();
+            for (std.enums.values(sched.Role)) |role| {
+                const result = applied.get(role) orelse continue;
+                var sched_str: [128]u8 = undefined;
+                imgui.Text(std.fmt.bufPrintZ(&sched_str, "{s} threads: {s} {d}{s}, CPU mask 0x{x}", .{
+                    @tagName(role),
+                    @tagName(result.policy),
+                    result.priority,
+                    if (result.fell_back) " (real-time not permitted)" else "",
+                    result.cpus,
+                }) catch unreachable);
+            }
+
+            if (context.connecting.isRunning()) {
+                imgui.Text("Connecting...");
             } else {
+                // Only the PulseAudio backend requests smaller fragments
+                if (os_tag == .linux) {
+                    _ = imgui.Checkbox("Low latency", &context.low_latency);
+                }
                 _ = imgui.InputText("Application PID", &pid_str, @sizeOf(@TypeOf(pid_str)));
                 imgui.SameLine();
                 if (imgui.Button("Connect")) {
@@ -146,13 +304,12 @@ pub fn main() !void {
 
                 if (imgui.BeginCombo("Window Select", "Click for list")) {
                     if (!audio_source_list_is_open) {
-                        possible_audio_producers.clearRetainingCapacity();
-                        audio_producer_enumerator.enumerate(&possible_audio_producers) catch |e| {
+                        audio_producer_registry.refresh() catch |e| {
                             try context.err.setMessage("Unable to list audio sources: {s}", .{@errorName(e)}, allocator);
                         };
                     }
                     audio_source_list_is_open = true;
-                    for (possible_audio_producers.items) |producer| {
+                    for (audio_producers.items) |producer| {
                         if (imgui.Selectable_Bool(&producer.name)) {
                             const pid_len = std.mem.indexOfScalar(u8, &producer.process_id, 0) orelse producer.process_id.len;
                             std.log.info("PID: {s}\n", .{producer.process_id[0..pid_len]});
@@ -194,7 +351,14 @@ pub fn main() !void {
                     std.process.changeCurDir(visualizer_dir) catch {};
 
                     bob_impl.fill(@ptrCast(&context), visualizer.api.api);
-                    if (visualizer.create()) |err| {
+
+                    // Analyzers have to exist before the visualizer configures them in create
+                    const create_error: ?[]const u8 = blk: {
+                        context.setFlags(Flags.init(visualizer.info.enabled), allocator) catch |e| break :blk @errorName(e);
+                        break :blk visualizer.create();
+                    };
+
+                    if (create_error) |err| {
                         try context.err.setMessage("Failed to initialize visualizer: {s}", .{err}, allocator);
                         std.log.info("unloading visualizer", .{});
                         visualizer.destroy();
@@ -202,10 +366,9 @@ pub fn main() !void {
                         context.visualizer = null;
                         context.gui_state.clear();
                         current_name = null;
-                        context.flags = Flags{};
+                        try context.setFlags(Flags{}, allocator);
                         std.process.changeCurDir(bob_dir) catch {};
                     } else {
-                        context.flags = Flags.init(visualizer.info.enabled);
                         context.flags.log();
                         current_index = index;
                     }
@@ -221,7 +384,7 @@ pub fn main() !void {
                     context.visualizer = null;
                     context.gui_state.clear();
                     current_name = null;
-                    context.flags = Flags{};
+                    try context.setFlags(Flags{}, allocator);
                     std.process.changeCurDir(bob_dir) catch {};
                 } else {
                     const path = visualizer_list.getVisualizerParentPath(current_index.?) catch |e| blk: {
@@ -264,3 +427,13 @@ pub fn main() !void {
         }
     }
 }
+
+test {
+    _ = @import("audio/AudioAnalyzer.zig");
+    _ = @import("audio/buffer.zig");
+    _ = @import("audio/Filterbank.zig");
+    _ = @import("audio/generator/signal.zig");
+    _ = @import("audio/wav.zig");
+    _ = @import("offline.zig");
+    _ = @import("ThreadPool.zig");
+}
@@ -0,0 +1,429 @@
+//!
+//! Headless analysis of audio files, run with `bob analyze <file>`
+//!
+
+const std = @import("std");
+const AudioAnalyzer = @import("audio/AudioAnalyzer.zig");
+const Config = @import("audio/Config.zig");
+const Flags = @import("flags.zig").Flags;
+const wav = @import("audio/wav.zig");
+const signal = @import("audio/generator/signal.zig");
+const Resampler = @import("audio/resample.zig").Resampler;
+
+const log = std.log.scoped(.offline);
+
+const usage =
+    \\usage: bob analyze <file.wav | gen:signal> [options]
+    \\
+    \\options:
+    \\  --hop <frames>         frames analyzed per step (default 1024)
+    \\  --flags <name,...>     analyses to run, named as in flags.zig, or `all` (default all mono)
+    \\  --out <path>           feature stream output (default features.csv)
+    \\  --format <csv|bin>     feature stream format (default csv)
+    \\  --duration <seconds>   length of generated signals (default 30)
+    \\
+;
+
+const default_hop = 1024;
+
+/// The splixer holds at most this many frames per analysis step
+const max_hop = Config.windowSize() / Config.channel_count;
+
+pub const Format = enum {
+    /// One row per hop with a header naming each column
+    csv,
+
+    /// Header: "BOBF", then u32 version, sample rate, hop and column count,
+    /// then each column name as a u16 length followed by its bytes.
+    /// Rows: column count f32 values. All values are little-endian.
+    bin,
+};
+
+const Options = struct {
+    input: []const u8,
+    hop: usize = default_hop,
+    flags: Flags = .{
+        .frequency_mono = true,
+        .chromagram_mono = true,
+        .pulse_mono = true,
+        .tempo_mono = true,
+        .breaks_mono = true,
+        .key_mono = true,
+        .mood_mono = true,
+    },
+    out: []const u8 = "features.csv",
+    format: Format = .csv,
+    duration: f32 = 30.0,
+
+    fn parse(args: []const [:0]u8) !Options {
+        if (args.len == 0) {
+            return error.invalid_arguments;
+        }
+
+        var options = Options{ .input = args[0] };
+        var i: usize = 1;
+
+        while (i < args.len) : (i += 2) {
+            if (i + 1 >= args.len) {
+                log.err("missing value for {s}", .{args[i]});
+                return error.invalid_arguments;
+            }
+
+            const option = args[i];
+            const value = args[i + 1];
+
+            if (std.mem.eql(u8, option, "--hop")) {
+                options.hop = std.fmt.parseInt(usize, value, 10) catch return error.invalid_arguments;
+                if (options.hop == 0 or options.hop > max_hop) {
+                    log.err("hop must be between 1 and {d} frames", .{max_hop});
+                    return error.invalid_arguments;
+                }
+            } else if (std.mem.eql(u8, option, "--flags")) {
+                options.flags = try parseFlags(value);
+            } else if (std.mem.eql(u8, option, "--out")) {
+                options.out = value;
+            } else if (std.mem.eql(u8, option, "--format")) {
+                options.format = std.meta.stringToEnum(Format, value) orelse return error.invalid_arguments;
+            } else if (std.mem.eql(u8, option, "--duration")) {
+                options.duration = std.fmt.parseFloat(f32, value) catch return error.invalid_arguments;
+            } else {
+                log.err("unknown option {s}", .{option});
+                return error.invalid_arguments;
+            }
+        }
+
+        return options;
+    }
+
+    fn parseFlags(names: []const u8) !Flags {
+        var flags = Flags{};
+        var it = std.mem.splitScalar(u8, names, ',');
+
+        while (it.next()) |name| {
+            const all = std.mem.eql(u8, name, "all");
+            var found = all;
+
+            inline for (std.meta.fields(Flags)) |field| {
+                if (all or std.mem.eql(u8, name, field.name)) {
+                    @field(flags, field.name) = true;
+                    found = true;
+                }
+            }
+
+            if (!found) {
+                log.err("unknown analysis {s}", .{name});
+                return error.invalid_arguments;
+            }
+        }
+
+        // Key is computed from the chromagram
+        flags.chromagram_mono = flags.chromagram_mono or flags.key_mono;
+        flags.chromagram_stereo = flags.chromagram_stereo or flags.key_stereo;
+
+        return flags;
+    }
+};
+
+const Source = union(enum) {
+    file: wav.Reader,
+    resampled: struct {
+        reader: wav.Reader,
+        resampler: Resampler,
+        buffer: []f32,
+    },
+    generator: struct {
+        generator: signal.Generator,
+        frames_left: usize,
+    },
+
+    fn open(options: Options, allocator: std.mem.Allocator) !Source {
+        if (std.mem.startsWith(u8, options.input, Config.generator_prefix)) {
+            const sig = try signal.Signal.parse(options.input[Config.generator_prefix.len..]);
+            return .{ .generator = .{
+                .generator = signal.Generator.init(sig, Config.sample_rate),
+                .frames_left = @intFromFloat(options.duration * Config.sample_rate),
+            } };
+        }
+
+        var reader = try wav.Reader.open(options.input);
+        errdefer reader.close();
+
+        if (reader.sample_rate == Config.sample_rate) {
+            return .{ .file = reader };
+        }
+
+        log.info("resampling from {d} Hz", .{reader.sample_rate});
+
+        // Read at most one hop of output per call, conversion may round up by a frame
+        const frames = @max((options.hop - 1) * reader.sample_rate / Config.sample_rate, 1);
+
+        var resampler = try Resampler.init(reader.sample_rate, Config.sample_rate, Config.channel_count, frames, allocator);
+        errdefer resampler.deinit(allocator);
+
+        return .{ .resampled = .{
+            .reader = reader,
+            .resampler = resampler,
+            .buffer = try allocator.alloc(f32, frames * Config.channel_count),
+        } };
+    }
+
+    fn close(self: *Source, allocator: std.mem.Allocator) void {
+        switch (self.*) {
+            .file => |*reader| reader.close(),
+            .resampled => |*r| {
+                r.reader.close();
+                r.resampler.deinit(allocator);
+                allocator.free(r.buffer);
+            },
+            .generator => {},
+        }
+    }
+
+    /// Read interleaved stereo samples, returns the number of samples written
+    fn read(self: *Source, out: []f32) !usize {
+        switch (self.*) {
+            .file => |*reader| return reader.read(out),
+            .resampled => |*r| {
+                // Conversion delays output, so keep going until some arrives or the file ends
+                while (true) {
+                    const len = try r.reader.read(r.buffer);
+                    if (len == 0) {
+                        return 0;
+                    }
+
+                    const resampled = r.resampler.process(r.buffer[0..len]);
+                    if (resampled.len > 0) {
+                        const n = @min(resampled.len, out.len);
+                        @memcpy(out[0..n], resampled[0..n]);
+                        return n;
+                    }
+                }
+            },
+            .generator => |*g| {
+                const frames = @min(out.len / Config.channel_count, g.frames_left);
+                g.generator.render(out[0 .. frames * Config.channel_count]);
+                g.frames_left -= frames;
+                return frames * Config.channel_count;
+            },
+        }
+    }
+};
+
+/// Writes one row of features per analyzed hop
+const FeatureWriter = struct {
+    allocator: std.mem.Allocator,
+    format: Format,
+    sample_rate: u32,
+    hop: u32,
+
+    /// Column names, only collected while writing the first row
+    names: std.ArrayList([]u8),
+    row: std.ArrayList(f32),
+    rows_written: usize,
+
+    fn init(options: Options, allocator: std.mem.Allocator) FeatureWriter {
+        return FeatureWriter{
+            .allocator = allocator,
+            .format = options.format,
+            .sample_rate = Config.sample_rate,
+            .hop = @intCast(options.hop),
+            .names = std.ArrayList([]u8).init(allocator),
+            .row = std.ArrayList(f32).init(allocator),
+            .rows_written = 0,
+        };
+    }
+
+    fn deinit(self: *FeatureWriter) void {
+        for (self.names.items) |name| {
+            self.allocator.free(name);
+        }
+        self.names.deinit();
+        self.row.deinit();
+    }
+
+    fn column(self: *FeatureWriter, comptime name: []const u8, x: f32) !void {
+        if (self.rows_written == 0) {
+            try self.names.append(try self.allocator.dupe(u8, name));
+        }
+        try self.row.append(x);
+    }
+
+    fn columns(self: *FeatureWriter, comptime name: []const u8, xs: []const f32) !void {
+        if (self.rows_written == 0) {
+            for (0..xs.len) |i| {
+                try self.names.append(try std.fmt.allocPrint(self.allocator, name ++ "[{d}]", .{i}));
+            }
+        }
+        try self.row.appendSlice(xs);
+    }
+
+    fn key(self: *FeatureWriter, comptime name: []const u8, k: anytype) !void {
+        try self.column(name ++ "_pitch_class", @floatFromInt(k.pitch_class));
+        try self.column(name ++ "_type", @floatFromInt(k.key_type));
+        try self.column(name ++ "_confidence", k.confidence);
+    }
+
+    fn collect(self: *FeatureWriter, time: f32, analyzer: *AudioAnalyzer, flags: Flags) !void {
+        self.row.clearRetainingCapacity();
+
+        try self.column("time", time);
+
+        if (flags.frequency_mono) try self.columns("spectrum_mono", analyzer.spectral_analyzer_center.?.read());
+        if (flags.frequency_stereo) {
+            try self.columns("spectrum_left", analyzer.spectral_analyzer_left.?.read());
+            try self.columns("spectrum_right", analyzer.spectral_analyzer_right.?.read());
+        }
+        if (flags.frequency_side) try self.columns("spectrum_side", analyzer.spectral_analyzer_side.?.read());
+        if (flags.chromagram_mono) try self.columns("chroma_mono", &analyzer.chroma_center.?.chroma);
+        if (flags.chromagram_stereo) {
+            try self.columns("chroma_left", &analyzer.chroma_left.?.chroma);
+            try self.columns("chroma_right", &analyzer.chroma_right.?.chroma);
+        }
+        if (flags.key_mono) try self.key("key_mono", analyzer.key_center.result);
+        if (flags.key_stereo) {
+            try self.key("key_left", analyzer.key_left.result);
+            try self.key("key_right", analyzer.key_right.result);
+        }
+        if (flags.pulse_mono) try self.columns("pulse_mono", analyzer.beat_center.?.Eh[0..analyzer.beat_center.?.num_bins]);
+        if (flags.tempo_mono) try self.column("tempo_mono", analyzer.tempo_center.?.get_bpm());
+        if (flags.breaks_mono) try self.column("break_mono", @floatFromInt(@intFromBool(analyzer.breaks_center.in_break)));
+        if (flags.breaks_stereo) {
+            try self.column("break_left", @floatFromInt(@intFromBool(analyzer.breaks_left.in_break)));
+            try self.column("break_right", @floatFromInt(@intFromBool(analyzer.breaks_right.in_break)));
+        }
+        if (flags.mood_mono) try self.column("mood_mono", @floatFromInt(@intFromEnum(analyzer.mood_center.?.read())));
+    }
+
+    fn write(self: *FeatureWriter, writer: anytype) !void {
+        if (self.rows_written == 0) {
+            try self.writeHeader(writer);
+        }
+
+        switch (self.format) {
+            .csv => {
+                for (self.row.items, 0..) |x, i| {
+                    if (i > 0) try writer.writeByte(',');
+                    try writer.print("{d}", .{x});
+                }
+                try writer.writeByte('\n');
+            },
+            .bin => {
+                for (self.row.items) |x| {
+                    try writer.writeInt(u32, @bitCast(x), .little);
+                }
+            },
+        }
+
+        self.rows_written += 1;
+    }
+
+    fn writeHeader(self: *FeatureWriter, writer: anytype) !void {
+        switch (self.format) {
+            .csv => {
+                for (self.names.items, 0..) |name, i| {
+                    if (i > 0) try writer.writeByte(',');
+                    try writer.writeAll(name);
+                }
+                try writer.writeByte('\n');
+            },
+            .bin => {
+                try writer.writeAll("BOBF");
+                try writer.writeInt(u32, 1, .little);
+                try writer.writeInt(u32, self.sample_rate, .little);
+                try writer.writeInt(u32, self.hop, .little);
+                try writer.writeInt(u32, @intCast(self.names.items.len), .little);
+                for (self.names.items) |name| {
+                    try writer.writeInt(u16, @intCast(name.len), .little);
+                    try writer.writeAll(name);
+                }
+            },
+        }
+    }
+};
+
+/// Entry point for `bob analyze`, `args` excludes the program name and subcommand
+pub fn run(args: []const [:0]u8, allocator: std.mem.Allocator) !void {
+    const options = Options.parse(args) catch |e| {
+        std.debug.print(usage, .{});
+        return e;
+    };
+
+    var source = try Source.open(options, allocator);
+    defer source.close(allocator);
+
+    var analyzer = try AudioAnalyzer.init(allocator);
+    defer analyzer.deinit(allocator);
+
+    // The same input always gives the same tempo column
+    analyzer.background = false;
+    try analyzer.configure(options.flags, allocator);
+
+    const file = try std.fs.cwd().createFile(options.out, .{});
+    defer file.close();
+
+    var buffered = std.io.bufferedWriter(file.writer());
+    const writer = buffered.writer();
+
+    var features = FeatureWriter.init(options, allocator);
+    defer features.deinit();
+
+    const buffer = try allocator.alloc(f32, options.hop * Config.channel_count);
+    defer allocator.free(buffer);
+
+    log.info("analyzing {s}", .{options.input});
+    options.flags.log();
+
+    var frames: usize = 0;
+
+    // Only analysis is timed, not reading input or writing features
+    var timer = try std.time.Timer.start();
+    var analysis_ns: u64 = 0;
+
+    while (true) {
+        const len = try source.read(buffer);
+        if (len == 0) {
+            break;
+        }
+
+        timer.reset();
+        analyzer.analyze(buffer[0..len]);
+        analysis_ns += timer.read();
+        frames += len / Config.channel_count;
+
+        const time = @as(f32, @floatFromInt(frames)) / Config.sample_rate;
+        try features.collect(time, &analyzer, options.flags);
+        try features.write(writer);
+    }
+
+    try buffered.flush();
+
+    const elapsed = @as(f64, @floatFromInt(analysis_ns)) / std.time.ns_per_s;
+    const duration = @as(f64, @floatFromInt(frames)) / Config.sample_rate;
+
+    log.info("analyzed {d:.1} s of audio in {d:.3} s of analysis ({d:.1}x real time), {d} rows written to {s}", .{
+        duration,
+        elapsed,
+        duration / @max(elapsed, 1e-9),
+        features.rows_written,
+        options.out,
+    });
+}
+
+test "generator source produces its duration" {
+    const options = Options{ .input = Config.generator_prefix ++ "sine", .hop = 1000, .duration = 0.5 };
+
+    var source = try Source.open(options, std.testing.allocator);
+    defer source.close(std.testing.allocator);
+
+    var buffer: [1000 * Config.channel_count]f32 = undefined;
+    var frames: usize = 0;
+    while (true) {
+        const len = try source.read(&buffer);
+        if (len == 0) {
+            break;
+        }
+        frames += len / Config.channel_count;
+    }
+
+    try std.testing.expectEqual(@as(usize, @intFromFloat(options.duration * Config.sample_rate)), frames);
+}
@@ -1,4 +1,6 @@
+const std = @import("std");
 const os_tag = @import("builtin").os.tag;
+const Task = @import("../task.zig").Task;
 pub const AudioProducerEntry = @import("./AudioProducerEntry.zig");
 
 // TODO: Chrome source refers to this type of code as "window enumerator". Maybe that is a better name?
@@ -13,3 +15,61 @@ pub const enumerate = switch (os_tag) {
     .linux => @import("./linux.zig").enumerateAudioProducers,
     else => enumeratorNotImplementedForPlatform,
 };
+
+/// Long-lived source of the producer list. On Linux the list is kept up to date
+/// by server events, elsewhere it is re-enumerated on `refresh`.
+pub const Registry = switch (os_tag) {
+    .linux => @import("./linux.zig").Registry,
+    else => AsyncEnumerator,
+};
+
+/// Holds the most recently enumerated list, refreshing it on a background thread
+pub const AsyncEnumerator = struct {
+    /// Result of the last finished enumeration
+    list: AudioProducerEntry.List,
+
+    /// Filled by the background thread
+    pending: AudioProducerEntry.List,
+
+    task: Task(void),
+
+    pub fn init(allocator: std.mem.Allocator) AsyncEnumerator {
+        return AsyncEnumerator{
+            .list = AudioProducerEntry.List.init(allocator),
+            .pending = AudioProducerEntry.List.init(allocator),
+            .task = .{},
+        };
+    }
+
+    pub fn deinit(self: *AsyncEnumerator) void {
+        _ = self.task.wait();
+        self.list.deinit();
+        self.pending.deinit();
+    }
+
+    pub fn start(self: *AsyncEnumerator) !void {
+        try self.refresh();
+    }
+
+    /// Start a new enumeration unless one is already in progress
+    pub fn refresh(self: *AsyncEnumerator) !void {
+        if (self.task.state.load(.acquire) != .idle) {
+            return;
+        }
+
+        self.pending.clearRetainingCapacity();
+        try self.task.start(enumerate, .{&self.pending});
+    }
+
+    /// Copy a finished enumeration into `list`, returns whether there was one
+    pub fn read(self: *AsyncEnumerator, list: *AudioProducerEntry.List) !bool {
+        const result = self.task.poll() orelse return false;
+        try result;
+
+        std.mem.swap(AudioProducerEntry.List, &self.list, &self.pending);
+        list.clearRetainingCapacity();
+        try list.appendSlice(self.list.items);
+
+        return true;
+    }
+};
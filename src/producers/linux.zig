@@ -74,29 +74,7 @@ pub fn enumerateAudioProducers(list: *AudioProducerEntry.List) !void {
                 return;
             }
 
-            var key: [*c]const u8 = pulse.PA_PROP_APPLICATION_PROCESS_ID;
-            var value = pulse.pa_proplist_gets(info.?.proplist, key);
-            const process_id = std.mem.span(value orelse return);
-
-            key = pulse.PA_PROP_APPLICATION_NAME;
-            value = pulse.pa_proplist_gets(info.?.proplist, key);
-            var name = std.mem.span(value orelse return);
-
-            key = pulse.PA_PROP_MEDIA_NAME;
-            value = pulse.pa_proplist_gets(info.?.proplist, key);
-            if (value) |media_name| {
-                name = std.mem.span(media_name);
-            }
-
-            var entry: AudioProducerEntry = undefined;
-
-            const name_len = @min(name.len, entry.name.len - 1);
-            const process_id_len = @min(process_id.len, entry.process_id.len - 1);
-            @memcpy(entry.name[0..name_len], name);
-            @memcpy(entry.process_id[0..process_id_len], process_id);
-
-            entry.name[name_len] = 0;
-            entry.process_id[process_id_len] = 0;
+            const entry = entryFromInfo(info.?) orelse return;
 
             data_ptr.list.append(entry) catch {
                 data_ptr.ok = false;
@@ -114,3 +92,276 @@ pub fn enumerateAudioProducers(list: *AudioProducerEntry.List) !void {
     if (!list_data.ok)
         return error.@"Failed to list PulseAudio sink inputs";
 }
+
+/// Build an entry from a sink input, or null if it has no owning process
+fn entryFromInfo(info: *const pulse.pa_sink_input_info) ?AudioProducerEntry {
+    var key: [*c]const u8 = pulse.PA_PROP_APPLICATION_PROCESS_ID;
+    var value = pulse.pa_proplist_gets(info.proplist, key);
+    const process_id = std.mem.span(value orelse return null);
+
+    key = pulse.PA_PROP_APPLICATION_NAME;
+    value = pulse.pa_proplist_gets(info.proplist, key);
+    var name = std.mem.span(value orelse return null);
+
+    key = pulse.PA_PROP_MEDIA_NAME;
+    value = pulse.pa_proplist_gets(info.proplist, key);
+    if (value) |media_name| {
+        name = std.mem.span(media_name);
+    }
+
+    var entry: AudioProducerEntry = undefined;
+
+    const name_len = @min(name.len, entry.name.len - 1);
+    const process_id_len = @min(process_id.len, entry.process_id.len - 1);
+    @memcpy(entry.name[0..name_len], name);
+    @memcpy(entry.process_id[0..process_id_len], process_id);
+
+    entry.name[name_len] = 0;
+    entry.process_id[process_id_len] = 0;
+
+    return entry;
+}
+
+/// Keeps one PulseAudio context open and tracks sink inputs as they come and go,
+/// so the producer list can be read at any time without a server round trip.
+/// Must not be moved after `start`, the context callbacks hold a pointer to it.
+pub const Registry = struct {
+    const log = std.log.scoped(.producers);
+
+    const Item = struct {
+        /// Sink input index, as reported by subscription events
+        index: u32,
+        entry: AudioProducerEntry,
+    };
+
+    mainloop: ?*pulse.pa_threaded_mainloop,
+    context: ?*pulse.pa_context,
+
+    /// Guards everything below, which is written from the mainloop thread
+    mutex: std.Thread.Mutex,
+    items: std.ArrayList(Item),
+
+    /// Incremented on every change to `items`
+    generation: u64,
+    failed: bool,
+
+    /// Generation last copied out by `read`
+    read_generation: u64,
+
+    pub fn init(allocator: std.mem.Allocator) Registry {
+        return Registry{
+            .mainloop = null,
+            .context = null,
+            .mutex = .{},
+            .items = std.ArrayList(Item).init(allocator),
+            .generation = 0,
+            .failed = false,
+            .read_generation = 0,
+        };
+    }
+
+    pub fn deinit(self: *Registry) void {
+        if (self.mainloop) |mainloop| {
+            pulse.pa_threaded_mainloop_lock(mainloop);
+            if (self.context) |context| release(context);
+            pulse.pa_threaded_mainloop_unlock(mainloop);
+
+            pulse.pa_threaded_mainloop_stop(mainloop);
+            pulse.pa_threaded_mainloop_free(mainloop);
+        }
+
+        self.items.deinit();
+        self.* = undefined;
+    }
+
+    /// Connect to the server. Does not block, the list fills in once the context is ready.
+    pub fn start(self: *Registry) !void {
+        const mainloop = pulse.pa_threaded_mainloop_new() orelse {
+            return error.@"Failed to create mainloop";
+        };
+        errdefer pulse.pa_threaded_mainloop_free(mainloop);
+
+        const context = try self.connect(mainloop);
+        errdefer release(context);
+
+        if (pulse.pa_threaded_mainloop_start(mainloop) < 0) {
+            return error.@"Failed to start mainloop";
+        }
+
+        self.mainloop = mainloop;
+        self.context = context;
+    }
+
+    /// Reconnect if the connection failed or the server went away, for example
+    /// when it restarted. Otherwise subscription events keep the list up to date.
+    pub fn refresh(self: *Registry) !void {
+        const mainloop = self.mainloop orelse return self.start();
+
+        pulse.pa_threaded_mainloop_lock(mainloop);
+        defer pulse.pa_threaded_mainloop_unlock(mainloop);
+
+        if (self.context) |context| {
+            const state = pulse.pa_context_get_state(context);
+            if (state != pulse.PA_CONTEXT_FAILED and state != pulse.PA_CONTEXT_TERMINATED) {
+                return;
+            }
+
+            release(context);
+            self.context = null;
+        }
+
+        log.info("Reconnecting producer registry", .{});
+        self.context = try self.connect(mainloop);
+    }
+
+    /// Copy the current list into `list` if it changed since the last call,
+    /// returns whether it did. Fails once if the server connection was lost.
+    pub fn read(self: *Registry, list: *AudioProducerEntry.List) !bool {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        if (self.failed) {
+            self.failed = false;
+            return error.@"Lost connection to PulseAudio server";
+        }
+
+        if (self.generation == self.read_generation) {
+            return false;
+        }
+
+        list.clearRetainingCapacity();
+        try list.ensureTotalCapacity(self.items.items.len);
+        for (self.items.items) |item| {
+            list.appendAssumeCapacity(item.entry);
+        }
+
+        self.read_generation = self.generation;
+
+        return true;
+    }
+
+    /// New context reporting to `self`, connecting in the background.
+    /// Called with the mainloop locked once it runs.
+    fn connect(self: *Registry, mainloop: *pulse.pa_threaded_mainloop) !*pulse.pa_context {
+        const api = pulse.pa_threaded_mainloop_get_api(mainloop);
+        const context = pulse.pa_context_new(api, "bob-producer-registry") orelse {
+            return error.@"Failed to create context";
+        };
+        errdefer pulse.pa_context_unref(context);
+
+        pulse.pa_context_set_state_callback(context, stateCallback, @ptrCast(self));
+        pulse.pa_context_set_subscribe_callback(context, subscribeCallback, @ptrCast(self));
+
+        if (pulse.pa_context_connect(context, null, pulse.PA_CONTEXT_NOAUTOSPAWN, null) < 0) {
+            return error.@"Failed to connect to PulseAudio server";
+        }
+
+        return context;
+    }
+
+    /// Disconnect without reporting the context's own termination as a lost connection
+    fn release(context: *pulse.pa_context) void {
+        pulse.pa_context_set_state_callback(context, null, null);
+        pulse.pa_context_set_subscribe_callback(context, null, null);
+        pulse.pa_context_disconnect(context);
+        pulse.pa_context_unref(context);
+    }
+
+    fn update(self: *Registry, index: u32, entry: AudioProducerEntry) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        defer self.generation += 1;
+
+        for (self.items.items) |*item| {
+            if (item.index == index) {
+                item.entry = entry;
+                return;
+            }
+        }
+
+        self.items.append(.{ .index = index, .entry = entry }) catch {
+            log.err("Failed to add sink input {d}", .{index});
+        };
+    }
+
+    fn remove(self: *Registry, index: u32) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        for (self.items.items, 0..) |item, i| {
+            if (item.index == index) {
+                _ = self.items.orderedRemove(i);
+                self.generation += 1;
+                return;
+            }
+        }
+    }
+
+    fn stateCallback(ctx: ?*pulse.pa_context, userdata: ?*anyopaque) callconv(.C) void {
+        const self: *Registry = @ptrCast(@alignCast(userdata.?));
+
+        switch (pulse.pa_context_get_state(ctx)) {
+            pulse.PA_CONTEXT_READY => {
+                if (pulse.pa_context_subscribe(ctx, pulse.PA_SUBSCRIPTION_MASK_SINK_INPUT, null, null)) |op| {
+                    pulse.pa_operation_unref(op);
+                }
+                if (pulse.pa_context_get_sink_input_info_list(ctx, infoCallback, userdata)) |op| {
+                    pulse.pa_operation_unref(op);
+                }
+            },
+            // Replaced by the next `refresh`
+            pulse.PA_CONTEXT_FAILED, pulse.PA_CONTEXT_TERMINATED => {
+                log.err("Producer registry lost its PulseAudio connection", .{});
+
+                self.mutex.lock();
+                defer self.mutex.unlock();
+
+                self.failed = true;
+                self.items.clearRetainingCapacity();
+                self.generation += 1;
+            },
+            else => {},
+        }
+    }
+
+    fn subscribeCallback(
+        ctx: ?*pulse.pa_context,
+        event: pulse.pa_subscription_event_type_t,
+        index: u32,
+        userdata: ?*anyopaque,
+    ) callconv(.C) void {
+        const self: *Registry = @ptrCast(@alignCast(userdata.?));
+
+        const Event = pulse.pa_subscription_event_type_t;
+
+        const facility = event & @as(Event, pulse.PA_SUBSCRIPTION_EVENT_FACILITY_MASK);
+        if (facility != @as(Event, pulse.PA_SUBSCRIPTION_EVENT_SINK_INPUT)) {
+            return;
+        }
+
+        const kind = event & @as(Event, pulse.PA_SUBSCRIPTION_EVENT_TYPE_MASK);
+        if (kind == @as(Event, pulse.PA_SUBSCRIPTION_EVENT_REMOVE)) {
+            self.remove(index);
+        } else if (pulse.pa_context_get_sink_input_info(ctx, index, infoCallback, userdata)) |op| {
+            pulse.pa_operation_unref(op);
+        }
+    }
+
+    fn infoCallback(
+        ctx: ?*pulse.pa_context,
+        info: ?*const pulse.pa_sink_input_info,
+        eol: c_int,
+        userdata: ?*anyopaque,
+    ) callconv(.C) void {
+        _ = ctx;
+        const self: *Registry = @ptrCast(@alignCast(userdata.?));
+
+        if (eol != 0) {
+            return;
+        }
+
+        const entry = entryFromInfo(info orelse return) orelse return;
+        self.update(info.?.index, entry);
+    }
+};
@@ -0,0 +1,192 @@
+//!
+//! Scheduling policy and CPU affinity per thread role. Each thread applies its
+//! role's settings to itself, real-time policies fall back to a raised nice
+//! value when the process lacks the privilege.
+//!
+
+const std = @import("std");
+const builtin = @import("builtin");
+
+const log = std.log.scoped(.sched);
+
+pub const Role = enum {
+    /// Capture backend threads, PulseAudio mainloop, PipeWire data loop, WASAPI, CoreAudio
+    capture,
+
+    /// Analysis pool workers, which also run background jobs like tempo
+    analysis,
+
+    /// The main thread, drawing and visualizer updates
+    render,
+};
+
+pub const Policy = enum {
+    /// Time sharing, `priority` is the nice value
+    normal,
+    fifo,
+    rr,
+};
+
+pub const Settings = struct {
+    policy: Policy = .normal,
+
+    /// Real-time priority from 1 to 99, or the nice value for `normal`
+    priority: i32 = 0,
+
+    /// CPUs the role is pinned to, none pins nothing
+    cpus: u64 = 0,
+
+    pub const Error = error{invalid_settings};
+
+    /// `policy[:priority][@cpu,cpu...]`, for example `fifo:70@2,3` or `normal:-5`
+    pub fn parse(text: []const u8) Error!Settings {
+        var settings = Settings{};
+
+        const at = std.mem.indexOfScalar(u8, text, '@');
+        const head = text[0 .. at orelse text.len];
+
+        var parts = std.mem.splitScalar(u8, head, ':');
+        settings.policy = std.meta.stringToEnum(Policy, parts.first()) orelse return Error.invalid_settings;
+        if (parts.next()) |priority| {
+            settings.priority = std.fmt.parseInt(i32, priority, 10) catch return Error.invalid_settings;
+        } else if (settings.policy != .normal) {
+            settings.priority = default_rt_priority;
+        }
+
+        switch (settings.policy) {
+            .normal => if (settings.priority < -20 or settings.priority > 19) return Error.invalid_settings,
+            .fifo, .rr => if (settings.priority < 1 or settings.priority > 99) return Error.invalid_settings,
+        }
+
+        if (at) |i| {
+            var cpus = std.mem.splitScalar(u8, text[i + 1 ..], ',');
+            while (cpus.next()) |cpu| {
+                const index = std.fmt.parseInt(u6, cpu, 10) catch return Error.invalid_settings;
+                settings.cpus |= @as(u64, 1) << index;
+            }
+        }
+
+        return settings;
+    }
+};
+
+/// What a thread of the role ended up with
+pub const Applied = struct {
+    policy: Policy,
+    priority: i32,
+    cpus: u64,
+
+    /// The requested real-time policy was not permitted
+    fell_back: bool,
+};
+
+const default_rt_priority = 50;
+
+/// Nice value used when a real-time policy is not permitted
+const fallback_nice = -10;
+
+/// Set from the command line before any thread of the role starts
+pub var config = std.EnumArray(Role, Settings).initFill(.{});
+
+var report_mutex = std.Thread.Mutex{};
+var report = std.EnumArray(Role, ?Applied).initFill(null);
+
+threadlocal var applied_role: ?Role = null;
+
+/// Apply the settings of `role` to the calling thread
+pub fn apply(role: Role) void {
+    applied_role = role;
+
+    const settings = config.get(role);
+    if (settings.policy == .normal and settings.priority == 0 and settings.cpus == 0) {
+        return;
+    }
+
+    var result = Applied{ .policy = .normal, .priority = 0, .cpus = 0, .fell_back = false };
+
+    if (builtin.os.tag != .linux) {
+        log.warn("{s}: scheduling settings are only supported on Linux", .{@tagName(role)});
+    } else {
+        if (settings.policy != .normal) {
+            if (setScheduler(settings.policy, settings.priority)) {
+                result.policy = settings.policy;
+                result.priority = settings.priority;
+            } else |e| {
+                log.warn("{s}: {s} {d} not permitted ({s}), raising nice instead", .{ @tagName(role), @tagName(settings.policy), settings.priority, @errorName(e) });
+                result.fell_back = true;
+            }
+        }
+
+        if (result.policy == .normal) {
+            const nice = if (settings.policy == .normal) settings.priority else fallback_nice;
+            if (setNice(nice)) {
+                result.priority = nice;
+            } else |e| {
+                log.warn("{s}: nice {d} not permitted ({s})", .{ @tagName(role), nice, @errorName(e) });
+            }
+        }
+
+        if (settings.cpus != 0) {
+            if (setAffinity(settings.cpus)) {
+                result.cpus = settings.cpus;
+            } else |e| {
+                log.warn("{s}: unable to pin to CPUs {b}: {s}", .{ @tagName(role), settings.cpus, @errorName(e) });
+            }
+        }
+    }
+
+    report_mutex.lock();
+    defer report_mutex.unlock();
+    report.set(role, result);
+}
+
+/// `apply` for threads owned by a library, where the only hook is a callback
+pub inline fn applyOnce(role: Role) void {
+    if (applied_role == null) {
+        apply(role);
+    }
+}
+
+/// The outcome for each role a thread applied, null for untouched roles
+pub fn applied() std.EnumArray(Role, ?Applied) {
+    report_mutex.lock();
+    defer report_mutex.unlock();
+    return report;
+}
+
+const linux = std.os.linux;
+
+fn check(rc: usize) !void {
+    switch (std.posix.errno(rc)) {
+        .SUCCESS => {},
+        .PERM, .ACCES => return error.permission_denied,
+        .INVAL => return error.invalid_argument,
+        else => return error.unexpected,
+    }
+}
+
+fn setScheduler(policy: Policy, priority: i32) !void {
+    const param = extern struct { priority: c_int }{ .priority = priority };
+    const mode: usize = switch (policy) {
+        .normal => 0,
+        .fifo => 1,
+        .rr => 2,
+    };
+    // pid 0 is the calling thread
+    try check(linux.syscall3(.sched_setscheduler, 0, mode, @intFromPtr(&param)));
+}
+
+fn setNice(nice: i32) !void {
+    // Nice values are per thread on Linux, who 0 is the calling thread
+    const prio_process = 0;
+    try check(linux.syscall3(.setpriority, prio_process, 0, @bitCast(@as(isize, nice))));
+}
+
+fn setAffinity(cpus: u64) !void {
+    // cpu_set_t, CPU n is bit n of an array of words
+    var mask = [_]usize{0} ** (1024 / @bitSizeOf(usize));
+    for (mask[0 .. @bitSizeOf(u64) / @bitSizeOf(usize)], 0..) |*word, i| {
+        word.* = @truncate(cpus >> @intCast(i * @bitSizeOf(usize)));
+    }
+    try check(linux.syscall3(.sched_setaffinity, 0, @sizeOf(@TypeOf(mask)), @intFromPtr(&mask)));
+}
@@ -0,0 +1,73 @@
+//!
+//! Runs a function call on a background thread with a completion state
+//! that the UI thread polls, so it never blocks waiting for the result
+//!
+
+const std = @import("std");
+
+pub fn Task(comptime T: type) type {
+    return struct {
+        const Self = @This();
+
+        pub const State = enum(u8) {
+            idle,
+            running,
+            done,
+        };
+
+        state: std.atomic.Value(State) = std.atomic.Value(State).init(.idle),
+        thread: ?std.Thread = null,
+
+        /// Valid once state is done
+        result: anyerror!T = undefined,
+
+        /// Call `function` with `args` on a new thread. Fails if the task was started and not yet polled.
+        pub fn start(self: *Self, comptime function: anytype, args: anytype) !void {
+            if (self.state.load(.acquire) != .idle) {
+                return error.task_busy;
+            }
+
+            const Args = @TypeOf(args);
+            const Wrapper = struct {
+                fn run(task: *Self, inner_args: Args) void {
+                    task.result = @call(.auto, function, inner_args);
+                    task.state.store(.done, .release);
+                }
+            };
+
+            self.state.store(.running, .release);
+            errdefer self.state.store(.idle, .release);
+
+            self.thread = try std.Thread.spawn(.{}, Wrapper.run, .{ self, args });
+        }
+
+        pub fn isRunning(self: *const Self) bool {
+            return self.state.load(.acquire) == .running;
+        }
+
+        /// Returns the result if the task has finished, otherwise null. Never blocks.
+        pub fn poll(self: *Self) ?anyerror!T {
+            if (self.state.load(.acquire) != .done) {
+                return null;
+            }
+
+            return self.join();
+        }
+
+        /// Block until the task has finished, returns null if it was never started.
+        pub fn wait(self: *Self) ?anyerror!T {
+            if (self.state.load(.acquire) == .idle) {
+                return null;
+            }
+
+            return self.join();
+        }
+
+        fn join(self: *Self) anyerror!T {
+            self.thread.?.join();
+            self.thread = null;
+            self.state.store(.idle, .release);
+            return self.result;
+        }
+    };
+}
@@ -0,0 +1,185 @@
+//!
+//! Timing zones recorded into per-thread buffers and exported as Chrome trace
+//! JSON, which Perfetto and chrome://tracing open. A disabled zone costs one
+//! atomic load.
+//!
+
+const std = @import("std");
+
+const log = std.log.scoped(.trace);
+
+/// Buffers handed out to threads, threads beyond this are not recorded
+const max_threads = 32;
+
+/// Zones per thread and recording, later zones are dropped
+const events_per_thread = 8192;
+
+const Event = struct {
+    name: [*:0]const u8,
+    start: u64,
+    end: u64,
+};
+
+/// Written by one thread only, read by `write` up to the published length
+const Buffer = struct {
+    events: [events_per_thread]Event,
+    len: std.atomic.Value(usize),
+    thread_id: std.Thread.Id,
+    thread_name: ?[*:0]const u8,
+};
+
+var buffers: ?*[max_threads]Buffer = null;
+var claimed = std.atomic.Value(usize).init(0);
+
+var recording = std.atomic.Value(bool).init(false);
+
+/// Bumped by `start` so threads claim a fresh buffer
+var session = std.atomic.Value(u32).init(0);
+
+var epoch: std.time.Instant = undefined;
+
+threadlocal var local: ?*Buffer = null;
+threadlocal var local_session: u32 = 0;
+threadlocal var local_name: ?[*:0]const u8 = null;
+
+pub const Zone = struct {
+    name: [*:0]const u8,
+    start: u64,
+    buffer: ?*Buffer,
+
+    /// Recording `buffer` was claimed for
+    session: u32,
+
+    pub fn end(self: Zone) void {
+        const buffer = self.buffer orelse return;
+
+        // A recording started since the zone opened may have handed the buffer to another thread
+        if (session.load(.acquire) != self.session) {
+            return;
+        }
+
+        const index = buffer.len.load(.monotonic);
+        if (index == events_per_thread) {
+            return;
+        }
+
+        buffer.events[index] = .{ .name = self.name, .start = self.start, .end = now() };
+        buffer.len.store(index + 1, .release);
+    }
+};
+
+/// Time the code until `end`. `name` has to outlive the recording, use a literal or `@tagName`.
+pub inline fn zone(name: [:0]const u8) Zone {
+    if (!recording.load(.monotonic)) {
+        return .{ .name = name.ptr, .start = 0, .buffer = null, .session = 0 };
+    }
+    const buffer = threadBuffer();
+    return .{ .name = name.ptr, .start = now(), .buffer = buffer, .session = local_session };
+}
+
+/// Label the calling thread in exported traces
+pub fn nameThread(name: [:0]const u8) void {
+    local_name = name.ptr;
+    if (local) |buffer| buffer.thread_name = name.ptr;
+}
+
+pub fn isRecording() bool {
+    return recording.load(.acquire);
+}
+
+/// Begin a new recording, dropping the previous one
+pub fn start() !void {
+    // Not from the application allocator, so recording does not show up in allocation counts
+    if (buffers == null) {
+        buffers = try std.heap.page_allocator.create([max_threads]Buffer);
+    }
+
+    epoch = try std.time.Instant.now();
+    claimed.store(0, .monotonic);
+    _ = session.fetchAdd(1, .release);
+    recording.store(true, .release);
+
+    log.info("recording", .{});
+}
+
+pub fn stop() void {
+    recording.store(false, .release);
+}
+
+pub fn deinit() void {
+    stop();
+    if (buffers) |b| std.heap.page_allocator.destroy(b);
+    buffers = null;
+}
+
+/// Stop recording and write the trace to `path`
+pub fn save(path: []const u8) !void {
+    stop();
+
+    const file = try std.fs.cwd().createFile(path, .{});
+    defer file.close();
+
+    var buffered = std.io.bufferedWriter(file.writer());
+    try write(buffered.writer());
+    try buffered.flush();
+
+    log.info("wrote {s}", .{path});
+}
+
+/// Chrome trace event format, one complete event per zone
+pub fn write(writer: anytype) !void {
+    try writer.writeAll("{\"traceEvents\":[\n");
+
+    var first = true;
+    const all: []const Buffer = if (buffers) |b| b else &.{};
+
+    for (all[0..@min(claimed.load(.acquire), all.len)]) |*buffer| {
+        const tid = buffer.thread_id;
+
+        if (buffer.thread_name) |name| {
+            if (!first) try writer.writeAll(",\n");
+            first = false;
+            try writer.print("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{d},\"args\":{{\"name\":\"{s}\"}}}}", .{ tid, name });
+        }
+
+        for (buffer.events[0..buffer.len.load(.acquire)]) |event| {
+            if (!first) try writer.writeAll(",\n");
+            first = false;
+            try writer.print("{{\"name\":\"{s}\",\"ph\":\"X\",\"pid\":1,\"tid\":{d},\"ts\":{d:.3},\"dur\":{d:.3}}}", .{
+                event.name,
+                tid,
+                @as(f64, @floatFromInt(event.start)) / std.time.ns_per_us,
+                @as(f64, @floatFromInt(event.end -| event.start)) / std.time.ns_per_us,
+            });
+        }
+    }
+
+    try writer.writeAll("\n]}\n");
+}
+
+fn now() u64 {
+    const instant = std.time.Instant.now() catch return 0;
+    return instant.since(epoch);
+}
+
+/// The calling thread's buffer for this recording, claimed without locking
+fn threadBuffer() ?*Buffer {
+    const current = session.load(.acquire);
+    if (local != null and local_session == current) {
+        return local;
+    }
+
+    const index = claimed.fetchAdd(1, .acq_rel);
+    if (index >= max_threads) {
+        return null;
+    }
+
+    const buffer = &buffers.?[index];
+    buffer.len.store(0, .monotonic);
+    buffer.thread_id = std.Thread.getCurrentId();
+    buffer.thread_name = local_name;
+
+    local = buffer;
+    local_session = current;
+    return buffer;
+}